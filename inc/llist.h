@@ -19,6 +19,8 @@
 #define LLIST_H_
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
 
 /*
  * E_LLIST
@@ -34,7 +36,8 @@ typedef enum {
 	LLIST_MALLOC_ERROR,		/**< Error: Memory allocation error*/
 	LLIST_NOT_IMPLEMENTED,          /**< Error: Implementation missing*/
 	LLIST_MULTITHREAD_ISSUE,        /**< Error: Multithreading issue*/
-	LLIST_ERROR			/**< Error: Generic error*/
+	LLIST_ERROR,			/**< Error: Generic error*/
+	LLIST_FULL			/**< Error: Bounded list is full*/
 } E_LLIST;
 
 #define ADD_NODE_FRONT		(1 << 0)
@@ -46,7 +49,18 @@ typedef enum {
 #define SORT_LIST_ASCENDING (1 << 0)
 #define SORT_LIST_DESCENDING ~SORT_LIST_ASCENDING
 
+#define ITER_READ_ONLY (1 << 0)
+
 #define FLAG_MT_SUPPORT  (1 << 0)
+#define FLAG_NO_SIMD     (1 << 1)
+#define FLAG_STATS       (1 << 2)
+#define FLAG_POSITIONAL_INDEX (1 << 3)
+#define FLAG_DEFERRED_RECLAIM (1 << 4)
+#define FLAG_RING_BOUNDED (1 << 5)
+#define FLAG_SPSC         (1 << 6)
+#define FLAG_WORK_STEALING (1 << 7)
+#define FLAG_PRIORITY_QUEUE (1 << 8)
+#define FLAG_PRIORITY_MAX  (1 << 9)
 
 typedef void *llist;
 typedef void *llist_node;
@@ -57,6 +71,39 @@ typedef void (*node_func)(llist_node node);
 // function prototypes with user arguments
 typedef void (*node_func_arg)(llist_node node, void *arg);
 
+/**
+* @brief Test a node
+* @param[in] node llist_node
+* @param[in] arg user argument
+* @return true if the node matches, false otherwise
+*/
+typedef bool (*node_predicate)(llist_node node, void *arg);
+
+/**
+* @brief Relocate a node, see llist_compact()
+* @param[in] node llist_node
+* @param[in] arg user argument
+* @return the node at its new location, the old one is not used anymore
+*/
+typedef llist_node (*node_move)(llist_node node, void *arg);
+
+/**
+* @brief Map a node to a value, see llist_parallel_map_reduce()
+* @param[in] node llist_node
+* @param[in] arg user argument
+* @return the mapped value
+*/
+typedef void *(*node_map)(llist_node node, void *arg);
+
+/**
+* @brief Combine two mapped values, see llist_parallel_map_reduce()
+* @param[in] first the value accumulated so far
+* @param[in] second the value to fold into it
+* @param[in] arg user argument
+* @return the combined value
+*/
+typedef void *(*node_combine)(void *first, void *second, void *arg);
+
 /**
 * @brief Compares two nodes in a list
 * @param[in] first llist_node
@@ -74,18 +121,193 @@ typedef int (*comperator)(llist_node first, llist_node second);
 */
 typedef bool (*equal)(llist_node, llist_node);
 
+/**
+* @brief Hash a node, nodes that are equal must hash to the same value
+* @param[in] node llist_node
+* @return the hash of the node
+*/
+typedef unsigned long (*node_hash)(llist_node node);
+
+/**
+* @brief Serialize a node into a buffer
+* @param[in] node the node to serialize
+* @param[out] buf destination buffer, may be NULL when len is 0
+* @param[in] len size of buf
+* @return the number of bytes the encoded node takes. If it's larger than len
+* nothing was written and the caller should retry with a larger buffer.
+*/
+typedef size_t (*node_encoder)(llist_node node, void *buf, size_t len);
+
+/**
+* @brief Rebuild a node from a buffer written by a node_encoder
+* @param[in] buf encoded node
+* @param[in] len size of the encoded node
+* @return the new node, NULL on error
+*/
+typedef llist_node (*node_decoder)(const void *buf, size_t len);
+
+typedef void *llist_sorter;
+
+/**
+ * @brief A cursor over a list, see llist_iter_begin()
+ * @note The members are private to the library
+ */
+typedef struct {
+	llist list;
+	void *prev;	/**< wrapper before the cursor */
+	void *cur;	/**< wrapper under the cursor, NULL if none */
+	int flags;
+} llist_iter;
+
+/*
+ * E_LLIST_KEY
+ * Key types of a typed-key list (llist_keyed)
+ */
+typedef enum {
+	LLIST_KEY_INT64 = 0x00,		/**< int64_t keys */
+	LLIST_KEY_DOUBLE,		/**< double keys, NaN keys are not supported */
+	LLIST_KEY_BYTES			/**< fixed length keys compared with memcmp */
+} E_LLIST_KEY;
+
+typedef void *llist_keyed;
+
+/*
+ * E_LLIST_OP
+ * Kinds of list operations, used to break down the statistics
+ */
+typedef enum {
+	LLIST_OP_ADD = 0x00,		/**< llist_add_node, llist_push */
+	LLIST_OP_INSERT,		/**< llist_insert_node, llist_insert_at, iterator inserts */
+	LLIST_OP_DELETE,		/**< llist_delete_node, llist_delete_at, llist_remove_if, llist_unique, llist_clear, iterator removals */
+	LLIST_OP_FIND,			/**< llist_find_node, llist_find_sorted */
+	LLIST_OP_POP,			/**< llist_pop, llist_steal */
+	LLIST_OP_READ,			/**< size, head, tail, peek and llist_get_at queries */
+	LLIST_OP_TRAVERSE,		/**< for_each variants, min/max, aggregates, iterators */
+	LLIST_OP_SORT,			/**< llist_sort, llist_partial_sort, llist_merge */
+	LLIST_OP_RESTRUCTURE,		/**< concat, reverse, compact, split, splice, partition, set operations */
+	LLIST_OP_OTHER,			/**< anything else */
+	LLIST_OP_COUNT			/**< number of operation kinds, not an operation */
+} E_LLIST_OP;
+
+#define LLIST_LOCK_WAIT_BUCKETS 32
+
+/**
+ * @brief Statistics of a list created with FLAG_STATS, see llist_get_stats()
+ */
+typedef struct {
+	unsigned long long ops[LLIST_OP_COUNT];	/**< calls, by kind */
+	unsigned long long scanned[LLIST_OP_COUNT];	/**< nodes visited, by kind */
+	unsigned long long lock_acquisitions;	/**< times the list lock was taken */
+	unsigned long long lock_contended;	/**< acquisitions that had to wait */
+	unsigned long long lock_wait_ns;	/**< total time spent waiting */
+	/** waits of [2^i, 2^(i+1)) nanoseconds, uncontended ones are in 0 */
+	unsigned long long lock_wait_histogram[LLIST_LOCK_WAIT_BUCKETS];
+	unsigned long long allocations;	/**< successful node wrapper and array allocations */
+	unsigned int peak_size;			/**< largest number of nodes held */
+} llist_stats;
+
+/**
+ * @brief Tracing callbacks, see llist_set_trace_hooks()
+ * @note The callbacks run in the thread calling the list function, begin
+ *       before the list lock is taken and end after it was released (the
+ *       iterator functions run with the lock held by llist_iter_begin()).
+ *       They must not call back into the library.
+ */
+typedef struct {
+	/** called when a list function starts, list is NULL for llist_create */
+	void (*begin)(E_LLIST_OP op, llist list, void *arg);
+	/** called when it returns, count is the number of nodes it touched
+	    and lock_wait_ns the time it spent waiting for the list lock */
+	void (*end)(E_LLIST_OP op, llist list, unsigned long count,
+		    unsigned long long lock_wait_ns, void *arg);
+	void *arg;	/**< passed to both callbacks */
+} llist_trace_hooks;
+
+typedef void *llist_tracer;
+
+typedef void *pllist;
+
+typedef void *shllist;
+
+/**
+* @brief Called with every node of a persistent list, see pllist_for_each()
+* @param[in] data the encoded node, in place in the list file
+* @param[in] len size of the encoded node
+* @param[in] arg user argument
+*/
+typedef void (*pllist_func)(const void *data, size_t len, void *arg);
+
 #define LLIST_INITALIZER {0, NULL, NULL, NULL, NULL}
 
 /**
  * @brief Create a list
+ * @details With FLAG_PRIORITY_QUEUE the list is a binary heap ordered by
+ *          compare_func: llist_add_node() and llist_push() are O(log n),
+ *          llist_peek() (llist_get_head()) returns the smallest node in O(1)
+ *          and llist_pop() removes it in O(log n). FLAG_PRIORITY_MAX makes
+ *          it a max heap. The for_each calls visit the nodes in no
+ *          particular order, llist_size(), llist_clear(), llist_destroy()
+ *          and llist_get_stats() work as usual, anything else returns
+ *          LLIST_NOT_IMPLEMENTED (or NULL).
  * @param[in] compare_func a function used to compare elements in the list
  * @param[in] equal_func a function used to check if two elements are equal
- * @param[in] flags used to identify whether we create a thread safe linked-list
+ * @param[in] flags used to identify whether we create a thread safe linked-list,
+ *		FLAG_POSITIONAL_INDEX to keep an index for the positional calls,
+ *		FLAG_DEFERRED_RECLAIM to destroy deleted nodes later, see
+ *		llist_reclaim(), FLAG_PRIORITY_QUEUE (and FLAG_PRIORITY_MAX)
+ *		for a priority queue, which requires compare_func
  * @return new list if success, NULL on error
  */
 llist llist_create(comperator compare_func, equal equal_func,
 		   unsigned int flags);
 
+/**
+ * @brief Create a list stored in a circular array
+ * @details Meant for FIFO/LIFO buffers: the nodes live in a circular array
+ *          of llist_node, so adding at either end, popping, head/tail/peek,
+ *          size and llist_get_at() are O(1) without any allocation per node,
+ *          and the for_each calls read the array sequentially. Only those
+ *          calls, llist_clear(), llist_destroy() and llist_get_stats() are
+ *          supported, everything else returns LLIST_NOT_IMPLEMENTED.
+ *
+ *          With FLAG_SPSC the list is a wait free queue between exactly one
+ *          producer thread, which may only call llist_add_node() at the rear
+ *          and llist_get_tail(), and one consumer thread, which may only call
+ *          llist_pop(), llist_peek() and llist_get_head(). No lock is ever
+ *          taken, the array never grows (a full queue returns LLIST_FULL)
+ *          and llist_size() is a snapshot. llist_for_each(), llist_get_at()
+ *          and llist_clear() aren't supported in that mode.
+ *
+ *          With FLAG_WORK_STEALING the list is a lock free work stealing
+ *          deque: its owner thread pushes and pops at the front with
+ *          llist_push() and llist_pop() (last in, first out), any other
+ *          thread takes the oldest node with llist_steal(). The array grows
+ *          as needed. As for FLAG_SPSC, llist_size() is a snapshot and the
+ *          calls that need a stable view aren't supported.
+ * @param[in] compare_func a function used to compare elements in the list
+ * @param[in] equal_func a function used to check if two elements are equal
+ * @param[in] capacity number of nodes the array holds initially, not 0
+ * @param[in] flags FLAG_MT_SUPPORT and FLAG_STATS as for llist_create(),
+ *		FLAG_RING_BOUNDED to fail adding to a full list with LLIST_FULL
+ *		instead of doubling the array, FLAG_SPSC for a single producer
+ *		single consumer queue, FLAG_WORK_STEALING for a work stealing
+ *		deque (FLAG_MT_SUPPORT is ignored by these two)
+ * @return new list if success, NULL on error
+ */
+llist llist_create_ring(comperator compare_func, equal equal_func,
+			unsigned int capacity, unsigned int flags);
+
+/**
+ * @brief Take the oldest node of a FLAG_WORK_STEALING list
+ * @details Meant for threads other than the owner of the list, it may run
+ *          concurrently with the owner and with other thieves.
+ * @param[in]  list a list created with FLAG_WORK_STEALING
+ * @param[out] node the node taken, only valid if LLIST_SUCCESS is returned
+ * @return int LLIST_SUCCESS if success, LLIST_NODE_NOT_FOUND if the list
+ *	       is empty, LLIST_NOT_IMPLEMENTED for other lists
+ */
+int llist_steal(llist list, llist_node *node);
+
 /**
  * @brief Destroys a list
  * @warning Call this function only if the list was created with llist_create
@@ -97,6 +319,20 @@ llist llist_create(comperator compare_func, equal equal_func,
  */
 void llist_destroy(llist list, bool destroy_nodes, node_func destructor);
 
+/**
+ * @brief Remove every node of a list, keeping the list itself
+ * @details The nodes are detached under the lock in O(1), they are
+ *          destroyed and freed once the lock is released. On a list created
+ *          with FLAG_DEFERRED_RECLAIM they are queued for llist_reclaim()
+ *          (or the background reclaimer) instead.
+ * @param[in] list the list to clear
+ * @param[in] destroy_nodes true if the nodes should be destroyed, false if not
+ * @param[in] destructor alternative destructor, if the previous param is true,
+ *			  if NULL is provided standard library c free() will be used
+ * @return int LLIST_SUCCESS if success
+ */
+int llist_clear(llist list, bool destroy_nodes, node_func destructor);
+
 /**
  * @brief Add a node to a list
  * @param[in] list the list to operator upon
@@ -128,6 +364,76 @@ int llist_insert_node(llist list,  llist_node new_node, llist_node pos_node,
 int llist_delete_node(llist list, llist_node node, bool destroy_node,
 		      node_func destructor);
 
+/**
+ * @brief Get the node at a given position
+ * @details Walks the list from the head, unless the list was created with
+ *          FLAG_POSITIONAL_INDEX: such a list builds an indexable skip list
+ *          over its nodes on the first positional call and the lookup takes
+ *          O(log n). llist_insert_at(), llist_delete_at(), llist_add_node()
+ *          and llist_pop() keep the index up to date, any other change to
+ *          the list drops it until the next positional call.
+ * @param[in]  list the list to operator upon
+ * @param[in]  index position of the node, 0 is the head
+ * @param[out] node the node found, only valid if LLIST_SUCCESS is returned
+ * @return int LLIST_SUCCESS if success, LLIST_NODE_NOT_FOUND if index is
+ *	       past the end of the list
+ */
+int llist_get_at(llist list, unsigned int index, llist_node *node);
+
+/**
+ * @brief Insert a node at a given position
+ * @param[in] list the list to operator upon
+ * @param[in] index position of the new node, the size of the list appends it
+ * @param[in] node the node to add
+ * @return int LLIST_SUCCESS if success, LLIST_NODE_NOT_FOUND if index is
+ *	       past the end of the list
+ */
+int llist_insert_at(llist list, unsigned int index, llist_node node);
+
+/**
+ * @brief Delete the node at a given position
+ * @param[in] list the list to operator upon
+ * @param[in] index position of the node to delete
+ * @param[in] destroy_node Should we run a destructor
+ * @param[in] destructor function, if NULL is provided, free() will be used
+ * @return int LLIST_SUCCESS if success, LLIST_NODE_NOT_FOUND if index is
+ *	       past the end of the list
+ */
+int llist_delete_at(llist list, unsigned int index, bool destroy_node,
+		    node_func destructor);
+
+/**
+ * @brief Destroy the nodes deleted from a FLAG_DEFERRED_RECLAIM list
+ * @details Deleting from such a list (delete, remove_if, pop, iterator
+ *          removals) only unlinks the node under the lock and queues it,
+ *          its destructor and the free() of its wrapper run here, in a
+ *          batch and without holding the list. llist_destroy() reclaims
+ *          whatever is still queued.
+ * @param[in] list the list to operator upon
+ * @return int LLIST_SUCCESS if success, nothing is done for a list created
+ *	       without FLAG_DEFERRED_RECLAIM
+ */
+int llist_reclaim(llist list);
+
+/**
+ * @brief Start a thread running llist_reclaim() in the background
+ * @details The thread runs every interval_ms, or earlier once enough
+ *          deleted nodes are queued. Destructors then run on that thread.
+ * @param[in] list a list created with FLAG_DEFERRED_RECLAIM and
+ *		FLAG_MT_SUPPORT
+ * @param[in] interval_ms longest time between two reclaims, not 0
+ * @return int LLIST_SUCCESS if success, LLIST_ERROR if the list doesn't
+ *	       qualify or a reclaimer is already running
+ */
+int llist_reclaimer_start(llist list, unsigned int interval_ms);
+
+/**
+ * @brief Stop the background reclaimer and reclaim what is left
+ * @param[in] list a list created with FLAG_DEFERRED_RECLAIM
+ * @return int LLIST_SUCCESS if success
+ */
+int llist_reclaimer_stop(llist list);
+
 /**
  * @brief Finds a node in a list
  * @param[in]  list the list to operator upon
@@ -139,6 +445,21 @@ int llist_delete_node(llist list, llist_node node, bool destroy_node,
  */
 int llist_find_node(llist list, void *data, llist_node *found);
 
+/**
+ * @brief Finds a node in a list using the list comparator
+ * @details After llist_sort() the list keeps a sampled index of its nodes,
+ *          so the lookup is a binary search followed by a short scan.
+ *          Any later change to the list drops the index and the lookup
+ *          falls back to a linear scan until the next llist_sort().
+ * @param[in]  list the list to operator upon
+ * @param[in]  data the data to find, compared with the list comparator
+ * @param[out] found a pointer for found node.
+ *		this pointer can be used only if
+ *		llist_find_sorted returned LLIST_SUCCESS
+ * @return LLIST_SUCCESS if success
+ */
+int llist_find_sorted(llist list, void *data, llist_node *found);
+
 /**
  * @brief operate on each element of the list
  * @param[in] list the list to operator upon
@@ -155,6 +476,147 @@ int llist_for_each(llist list, node_func func);
  * @return int LLIST_SUCCESS if success
  */
 int llist_for_each_arg(llist list, node_func_arg func, void *arg);
+/**
+ * @brief operate on each element of the list from several threads
+ * @details The list is split in nthreads segments of (almost) equal size,
+ *          each one handed to its own thread. The list is read locked for
+ *          the whole call and func runs concurrently, so it must be thread
+ *          safe.
+ * @param[in] list the list to operator upon
+ * @param[in] func the function to perform
+ * @param[in] arg passed to func
+ * @param[in] nthreads number of threads to use, 0 for one per online CPU
+ * @return int LLIST_SUCCESS if success
+ */
+int llist_parallel_for_each(llist list, node_func_arg func, void *arg,
+			    unsigned int nthreads);
+
+/**
+ * @brief map every node and reduce the results from several threads
+ * @details Segments are split like llist_parallel_for_each(). Each thread
+ *          folds its segment with combine(acc, map(node)), then the
+ *          segment results are combined in list order by the caller.
+ * @param[in] list the list to operator upon
+ * @param[in] map called for every node
+ * @param[in] combine used to reduce two mapped values into one
+ * @param[in] arg passed to map and combine
+ * @param[in] nthreads number of threads to use, 0 for one per online CPU
+ * @param[out] result the reduced value, NULL for an empty list
+ * @return int LLIST_SUCCESS if success
+ */
+int llist_parallel_map_reduce(llist list, node_map map, node_combine combine,
+			      void *arg, unsigned int nthreads, void **result);
+
+/**
+ * @brief operate on each element of the list until func asks to stop
+ * @param[in] list the list to operator upon
+ * @param[in] func the function to perform, returns true to stop
+ * @param[in] arg passed to func
+ * @return int LLIST_SUCCESS if func stopped the traversal,
+ *	   LLIST_NODE_NOT_FOUND if it reached the end of the list
+ */
+int llist_for_each_until(llist list, node_predicate func, void *arg);
+
+/**
+ * @brief Delete all the nodes matching a predicate
+ * @details The matching nodes are unlinked in a single pass under the lock,
+ *          destructors run and wrappers are released after unlocking.
+ * @param[in] list the list to operator upon
+ * @param[in] pred called with each node, returns true to delete it.
+ *		It's called with the list locked, it must not use the list.
+ * @param[in] arg passed to pred
+ * @param[in] destroy_nodes Should we run a destructor
+ * @param[in] destructor function, if NULL is provided, free() will be used
+ * @return int LLIST_SUCCESS if success
+ */
+int llist_remove_if(llist list, node_predicate pred, void *arg,
+		    bool destroy_nodes, node_func destructor);
+
+/**
+ * @brief Delete the duplicate nodes of a list, keeping the first of each
+ * @details Runs in linear time with a temporary hash set: equal_func is only
+ *          called on nodes with the same hash. The order of the kept nodes
+ *          doesn't change.
+ * @param[in] list the list to operator upon
+ * @param[in] hash_func hashes a node, equal nodes must hash the same.
+ *		It's called with the list locked, it must not use the list.
+ * @param[in] destroy_nodes Should we run a destructor
+ * @param[in] destructor function, if NULL is provided, free() will be used
+ * @return int LLIST_SUCCESS if success,
+ *	   LLIST_EQUAL_MISSING if the list has no equal function,
+ *	   LLIST_MALLOC_ERROR if the hash set couldn't be allocated
+ */
+int llist_unique(llist list, node_hash hash_func, bool destroy_nodes,
+		 node_func destructor);
+
+/**
+ * @brief Collapse runs of adjacent equal nodes, keeping the first of each
+ * @details A single pass with no extra memory. On a sorted list equal nodes
+ *          are adjacent, so this removes all of the duplicates.
+ * @param[in] list the list to operator upon
+ * @param[in] destroy_nodes Should we run a destructor
+ * @param[in] destructor function, if NULL is provided, free() will be used
+ * @return int LLIST_SUCCESS if success,
+ *	   LLIST_EQUAL_MISSING if the list has no equal function
+ */
+int llist_unique_sorted(llist list, bool destroy_nodes, node_func destructor);
+
+/**
+ * @brief Start iterating over a list
+ * @details The list stays locked until llist_iter_end() is called, for
+ *          writing unless ITER_READ_ONLY is given. Don't call other llist
+ *          functions on the same list in between.
+ * @param[in] list the list to operator upon
+ * @param[out] iter the iterator to initialize
+ * @param[in] flags ITER_READ_ONLY if the list won't be modified
+ * @return int LLIST_SUCCESS if success
+ */
+int llist_iter_begin(llist list, llist_iter *iter, int flags);
+
+/**
+ * @brief Move the cursor to the next node
+ * @param[in] iter the iterator to operate upon
+ * @param[out] node the node under the cursor
+ * @return int LLIST_SUCCESS if success, LLIST_NODE_NOT_FOUND at the end
+ */
+int llist_iter_next(llist_iter *iter, llist_node *node);
+
+/**
+ * @brief Remove the node under the cursor in O(1)
+ * @details The cursor is left between the neighbours of the removed node,
+ *          llist_iter_next() continues with the node that followed it.
+ * @param[in] iter the iterator to operate upon
+ * @param[in] destroy_node Should we run a destructor
+ * @param[in] destructor function, if NULL is provided, free() will be used
+ * @return int LLIST_SUCCESS if success
+ */
+int llist_iter_remove(llist_iter *iter, bool destroy_node,
+		      node_func destructor);
+
+/**
+ * @brief Insert a node before the cursor in O(1)
+ * @details The new node is behind the cursor and won't be visited.
+ * @param[in] iter the iterator to operate upon
+ * @param[in] node the node to add
+ * @return int LLIST_SUCCESS if success
+ */
+int llist_iter_insert_before(llist_iter *iter, llist_node node);
+
+/**
+ * @brief Insert a node after the cursor in O(1)
+ * @details The new node is the next one returned by llist_iter_next().
+ * @param[in] iter the iterator to operate upon
+ * @param[in] node the node to add
+ * @return int LLIST_SUCCESS if success
+ */
+int llist_iter_insert_after(llist_iter *iter, llist_node node);
+
+/**
+ * @brief Finish iterating and unlock the list
+ * @param[in] iter the iterator to operate upon
+ */
+void llist_iter_end(llist_iter *iter);
+
 /**
  * @brief sort a lists
  * @param[in] list the list to operator upon
@@ -163,6 +625,31 @@ int llist_for_each_arg(llist list, node_func_arg func, void *arg);
  */
 int llist_sort(llist list, int flags);
 
+/**
+ * @brief collect the k smallest (or largest) nodes without sorting the list
+ * @param[in] list the list to operate upon
+ * @param[in] k number of nodes to collect
+ * @param[in] flags SORT_LIST_ASCENDING for the k smallest nodes,
+ *		SORT_LIST_DESCENDING for the k largest
+ * @param[out] out array of at least k entries, filled in sorted order.
+ *		If the list holds less than k nodes the remaining
+ *		entries are set to NULL
+ * @note The list is only read, it is walked once in O(n log k)
+ * @return int LLIST_SUCCESS if success
+ */
+int llist_top_k(llist list, unsigned int k, int flags, llist_node *out);
+
+/**
+ * @brief sort only the first k positions of a list
+ * @param[in] list the list to operate upon
+ * @param[in] k number of leading positions to order
+ * @param[in] flags
+ * @note After the call the first k nodes are the k smallest (or largest) of
+ *       the list in sorted order, the rest follow in unspecified order
+ * @return int LLIST_SUCCESS if success
+ */
+int llist_partial_sort(llist list, unsigned int k, int flags);
+
 /**
  * @brief Returns the head node of the list
  * @param[in] list the list to operate on
@@ -226,6 +713,104 @@ int llist_concat(llist first, llist second);
  */
 int llist_merge(llist first, llist second);
 
+/**
+ * @brief Move the tail of a list, from a given position on, to another list
+ * @details The nodes are relinked, nothing is allocated or freed.
+ * @param[in] list the list to split
+ * @param[in] index position of the first node to move, 0 moves them all
+ * @param[in] out the list the nodes are appended to
+ * @return int LLIST_SUCCESS if success, LLIST_NODE_NOT_FOUND if index is
+ *	   past the end of the list, LLIST_ERROR if list and out are the same
+ */
+int llist_split_at(llist list, unsigned int index, llist out);
+
+/**
+ * @brief Move a run of nodes from one list into another
+ * @details The nodes from..to of src are unlinked and inserted, in the same
+ *          order, after pos in dest. Nodes are matched by identity, not with
+ *          the equal function. The nodes are relinked, nothing is allocated
+ *          or freed.
+ * @param[in] dest the list to insert into
+ * @param[in] pos the node of dest to insert after, NULL for the front
+ * @param[in] src the list to take the nodes from
+ * @param[in] from the first node to move, NULL for the head of src
+ * @param[in] to the last node to move, NULL for the tail of src
+ * @return int LLIST_SUCCESS if success, LLIST_NODE_NOT_FOUND if one of the
+ *	   nodes isn't there or to comes before from (nothing is moved then),
+ *	   LLIST_ERROR if dest and src are the same list
+ */
+int llist_splice(llist dest, llist_node pos, llist src, llist_node from,
+		 llist_node to);
+
+/**
+ * @brief Distribute the nodes of a list over two lists according to a test
+ * @details Nodes keep their relative order, they are relinked, nothing is
+ *          allocated or freed. list is empty afterwards.
+ * @param[in] list the list to partition
+ * @param[in] pred the test
+ * @param[in] arg passed to pred
+ * @param[in] out_true the list nodes passing the test are appended to
+ * @param[in] out_false the list the other nodes are appended to
+ * @return int LLIST_SUCCESS if success, LLIST_ERROR if any two of the lists
+ *	   are the same
+ */
+int llist_partition(llist list, node_predicate pred, void *arg,
+		    llist out_true, llist out_false);
+
+/**
+ * @brief Move the nodes of first that are also in second to another list
+ * @details With a hash function, a temporary hash set of second is built and
+ *          equal_func of first matches the nodes. Without one, both lists
+ *          must be sorted (llist_sort()) the same way with the same
+ *          comparator and are walked together, comparing to 0 meaning equal.
+ *          Either way it takes linear time. The nodes are relinked in their
+ *          order, the other nodes stay in first and second isn't changed.
+ *          Duplicates within first are all moved.
+ * @param[in] first the list to take the nodes from
+ * @param[in] second the list to look them up in
+ * @param[in] hash_func hashes a node, equal nodes must hash the same.
+ *		NULL to merge two sorted lists instead.
+ * @param[in] out the list the nodes are appended to, it is left sorted when
+ *		it was empty, sorted lists were merged and it has the same
+ *		comparator
+ * @return int LLIST_SUCCESS if success,
+ *	   LLIST_EQUAL_MISSING if hashing and first has no equal function,
+ *	   LLIST_MALLOC_ERROR if the hash set couldn't be allocated,
+ *	   LLIST_ERROR if any two of the lists are the same or, without
+ *	   hash_func, first and second aren't sorted the same way
+ */
+int llist_intersect(llist first, llist second, node_hash hash_func,
+		    llist out);
+
+/**
+ * @brief Move the nodes of first that aren't in second to another list
+ * @details Works like llist_intersect(), with the opposite test.
+ * @param[in] first the list to take the nodes from
+ * @param[in] second the list to look them up in
+ * @param[in] hash_func hashes a node, equal nodes must hash the same.
+ *		NULL to merge two sorted lists instead.
+ * @param[in] out the list the nodes are appended to
+ * @return int the same as llist_intersect()
+ */
+int llist_difference(llist first, llist second, node_hash hash_func,
+		     llist out);
+
+/**
+ * @brief Move the nodes of two lists to another one, without duplicates
+ * @details All of the nodes of first are moved, then each node of second
+ *          not equal to one already moved. first is empty afterwards and the
+ *          duplicates stay in second. When sorted lists are merged the result
+ *          is in order, otherwise the new nodes of second follow first's.
+ *          Works like llist_intersect() otherwise.
+ * @param[in] first the list whose nodes all move
+ * @param[in] second the list whose new nodes move
+ * @param[in] hash_func hashes a node, equal nodes must hash the same.
+ *		NULL to merge two sorted lists instead.
+ * @param[in] out the list the nodes are appended to
+ * @return int the same as llist_intersect()
+ */
+int llist_union(llist first, llist second, node_hash hash_func, llist out);
+
 /**
  * @brief get the maximum node in a given list
  * @param[in] list the list to operate upon
@@ -242,6 +827,37 @@ int llist_get_max(llist list, llist_node *max);
  */
 int llist_get_min(llist list, llist_node *min);
 
+/**
+ * @brief get both the minimum and the maximum node in a single traversal
+ * @param[in] list the list to operate upon
+ * @param[out] min minimum node
+ * @param[out] max maximum node
+ * @note Nodes are compared in pairs, about 1.5 comparisons per node
+ * @return int LLIST_SUCCESS if success
+ */
+int llist_get_min_max_both(llist list, llist_node *min, llist_node *max);
+
+/**
+ * @brief Result of llist_aggregate()
+ */
+typedef struct {
+	unsigned int count;	/**< number of nodes visited */
+	llist_node min;		/**< minimum node, NULL if there's no comparator */
+	llist_node max;		/**< maximum node, NULL if there's no comparator */
+} llist_aggregate_result;
+
+/**
+ * @brief count, find min/max and fold the list in a single traversal
+ * @param[in] list the list to operate upon
+ * @param[out] result count, min and max of the list
+ * @param[in] fold optional function called on every node, may be NULL
+ * @param[in] acc passed to fold, typically the fold accumulator
+ * @note min and max are only computed if the list has a comparator
+ * @return int LLIST_SUCCESS if success
+ */
+int llist_aggregate(llist list, llist_aggregate_result *result,
+		    node_func_arg fold, void *acc);
+
 /**
  * @brief Reverse a list
  * @param[in] list the list to operate upon
@@ -249,6 +865,346 @@ int llist_get_min(llist list, llist_node *min);
  */
 int llist_reverse(llist list);
 
+/**
+ * @brief Reallocate the list in list order to make traversals sequential
+ * @details All the internal node wrappers are moved into a single
+ *          contiguous block, in the order they appear in the list.
+ *          Optionally the nodes themselves are relocated too.
+ * @param[in] list the list to operate upon
+ * @param[in] move called with every node, in list order, returning its
+ *		new location. Can be NULL to keep the nodes where they are.
+ * @param[in] arg passed to move
+ * @return int LLIST_SUCCESS if success
+ */
+int llist_compact(llist list, node_move move, void *arg);
+
+/**
+ * @brief Write a list to a file
+ * @details The format is a small header (magic, version, node count)
+ *          followed by every node, in list order, as a length prefixed
+ *          record produced by encoder. Writes go through the FILE buffer.
+ * @param[in] list the list to write
+ * @param[in] file where to write, it's flushed on success
+ * @param[in] encoder serializes a node
+ * @return int LLIST_SUCCESS if success, LLIST_ERROR on a write error
+ */
+int llist_serialize(llist list, FILE *file, node_encoder encoder);
+
+/**
+ * @brief Read a list written by llist_serialize() and append its nodes
+ * @details All the nodes are decoded first, their internal wrappers are
+ *          allocated in blocks of bounded size as they are read, then the
+ *          whole chain is linked to the end of the list with one lock
+ *          acquisition.
+ * @param[in] list the list to append to
+ * @param[in] file where to read from, positioned at the list header
+ * @param[in] decoder rebuilds a node
+ * @param[in] destructor used to release the nodes decoded so far if the
+ *		file turns out to be bad, if NULL free() is used
+ * @return int LLIST_SUCCESS if success, LLIST_ERROR if the file is
+ *	   truncated or not a serialized list, if decoder failed or if the
+ *	   list would end up with more than UINT_MAX nodes
+ */
+int llist_deserialize(llist list, FILE *file, node_decoder decoder,
+		      node_func destructor);
+
+/**
+ * @brief Open a persistent list, creating the file if it doesn't exist
+ * @details A persistent list lives entirely in a memory mapped file and
+ *          links its nodes with file offsets, so opening an existing list
+ *          costs the same whatever its size. Nodes are stored encoded,
+ *          they are handed in through a node_encoder and out through a
+ *          node_decoder. The file is trusted, only its header is checked.
+ *          Only one process at a time may have a given file open.
+ * @param[in] path the list file
+ * @param[in] flags FLAG_MT_SUPPORT to share the list between threads
+ * @return new list if success, NULL on error or if the file isn't a
+ *	   persistent list
+ */
+pllist pllist_open(const char *path, unsigned int flags);
+
+/**
+ * @brief Flush a persistent list to its file and close it
+ * @param[in] list the list to close
+ * @return int LLIST_SUCCESS if success, LLIST_ERROR if the flush failed
+ */
+int pllist_close(pllist list);
+
+/**
+ * @brief Flush a persistent list to its file
+ * @param[in] list the list to flush
+ * @return int LLIST_SUCCESS if success
+ */
+int pllist_sync(pllist list);
+
+/**
+ * @brief Add a node to a persistent list
+ * @param[in] list the list to operate upon
+ * @param[in] node the node to store, it's encoded into the list file
+ * @param[in] encoder serializes the node
+ * @param[in] flags ADD_NODE_FRONT or ADD_NODE_REAR
+ * @return int LLIST_SUCCESS if success
+ */
+int pllist_add_node(pllist list, llist_node node, node_encoder encoder,
+		    int flags);
+
+/**
+ * @brief Add a node to the front of a persistent list
+ * @param[in] list the list to operate upon
+ * @param[in] node the node to store
+ * @param[in] encoder serializes the node
+ * @return int LLIST_SUCCESS if success
+ */
+int pllist_push(pllist list, llist_node node, node_encoder encoder);
+
+/**
+ * @brief Remove the first node of a persistent list
+ * @param[in] list the list to operate upon
+ * @param[in] decoder rebuilds the node from the list file
+ * @return the decoded node, NULL if the list is empty or decoder failed
+ *	   (in which case the node is left in the list)
+ */
+llist_node pllist_pop(pllist list, node_decoder decoder);
+
+/**
+ * @brief Get the first node of a persistent list, in place
+ * @param[in] list the list to operate upon
+ * @param[out] len if not NULL, where to store the size of the node
+ * @return the encoded node, NULL if the list is empty. It stays valid
+ *	   until the list is modified.
+ */
+const void *pllist_get_head(pllist list, size_t *len);
+
+/**
+ * @brief Get the last node of a persistent list, in place
+ * @param[in] list the list to operate upon
+ * @param[out] len if not NULL, where to store the size of the node
+ * @return the encoded node, NULL if the list is empty. It stays valid
+ *	   until the list is modified.
+ */
+const void *pllist_get_tail(pllist list, size_t *len);
+
+/**
+ * @brief Same as pllist_get_head()
+ */
+const void *pllist_peek(pllist list, size_t *len);
+
+/**
+ * @brief Run a function on every node of a persistent list, in place
+ * @param[in] list the list to operate upon
+ * @param[in] func called with every encoded node
+ * @param[in] arg passed to func
+ * @return int LLIST_SUCCESS if success
+ */
+int pllist_for_each(pllist list, pllist_func func, void *arg);
+
+/**
+ * @brief Return the number of nodes in a persistent list
+ * @param[in] list the list to operate upon
+ * @return number of nodes
+ */
+int pllist_size(pllist list);
+
+/**
+ * @brief check if a persistent list is empty
+ * @param[in] list the list to operate upon
+ * @return bool True if list is empty
+ */
+bool pllist_is_empty(pllist list);
+
+/**
+ * @brief Size of the memory region needed by a shared memory list
+ * @param[in] slots number of nodes the list can hold
+ * @param[in] slot_size size of a node
+ * @return the region size in bytes
+ */
+size_t shllist_region_size(unsigned int slots, size_t slot_size);
+
+/**
+ * @brief Create a list inside a memory region shared between processes
+ * @details The list header, a PTHREAD_PROCESS_SHARED lock and a pool of
+ *          fixed size slots are laid out in the region and linked with
+ *          offsets, so every process may map it at its own address. The
+ *          nodes of the list are the slots: get one with shllist_alloc(),
+ *          fill it and add it, the process that pops it uses it in place
+ *          and gives it back with shllist_free().
+ * @param[in] region the region, 16 bytes aligned
+ * @param[in] size size of region, see shllist_region_size()
+ * @param[in] slots number of slots in the pool
+ * @param[in] slot_size size of a slot
+ * @return the list, the same address as region, NULL on error
+ */
+shllist shllist_create(void *region, size_t size, unsigned int slots,
+		       size_t slot_size);
+
+/**
+ * @brief Use a shared memory list created by another process
+ * @param[in] region the region the list was created in, as mapped by the
+ *		calling process
+ * @return the list, NULL if there's no list in region
+ */
+shllist shllist_attach(void *region);
+
+/**
+ * @brief Release the lock of a shared memory list
+ * @warning No process may use the list anymore, the region itself belongs
+ *          to the caller
+ * @param[in] list the list to destroy
+ * @return int LLIST_SUCCESS if success
+ */
+int shllist_destroy(shllist list);
+
+/**
+ * @brief Size of the slots of a shared memory list
+ * @param[in] list the list to operate upon
+ * @return the slot size
+ */
+size_t shllist_slot_size(shllist list);
+
+/**
+ * @brief Take a free slot from the pool of a shared memory list
+ * @param[in] list the list to operate upon
+ * @return the slot, NULL if all of them are in use
+ */
+void *shllist_alloc(shllist list);
+
+/**
+ * @brief Give a slot back to the pool of a shared memory list
+ * @param[in] list the list to operate upon
+ * @param[in] data a slot returned by shllist_alloc() that isn't in the list
+ * @return int LLIST_SUCCESS if success, LLIST_ERROR if data isn't a slot
+ */
+int shllist_free(shllist list, void *data);
+
+/**
+ * @brief Add a slot to a shared memory list
+ * @param[in] list the list to operate upon
+ * @param[in] data a slot returned by shllist_alloc() that isn't in the list
+ * @param[in] flags ADD_NODE_FRONT or ADD_NODE_REAR
+ * @return int LLIST_SUCCESS if success, LLIST_ERROR if data isn't a slot
+ */
+int shllist_add_node(shllist list, void *data, int flags);
+
+/**
+ * @brief Remove the first slot of a shared memory list
+ * @param[in] list the list to operate upon
+ * @return the slot, owned by the caller until it's added again or freed,
+ *	   NULL if the list is empty
+ */
+void *shllist_pop(shllist list);
+
+/**
+ * @brief Get the first slot of a shared memory list
+ * @param[in] list the list to operate upon
+ * @return the slot, NULL if the list is empty
+ */
+void *shllist_get_head(shllist list);
+
+/**
+ * @brief Get the last slot of a shared memory list
+ * @param[in] list the list to operate upon
+ * @return the slot, NULL if the list is empty
+ */
+void *shllist_get_tail(shllist list);
+
+/**
+ * @brief Same as shllist_get_head()
+ */
+void *shllist_peek(shllist list);
+
+/**
+ * @brief Run a function on every slot of a shared memory list
+ * @param[in] list the list to operate upon
+ * @param[in] func called with every slot
+ * @param[in] arg passed to func
+ * @return int LLIST_SUCCESS if success
+ */
+int shllist_for_each(shllist list, node_func_arg func, void *arg);
+
+/**
+ * @brief Return the number of slots in a shared memory list
+ * @param[in] list the list to operate upon
+ * @return number of slots in the list
+ */
+int shllist_size(shllist list);
+
+/**
+ * @brief check if a shared memory list is empty
+ * @param[in] list the list to operate upon
+ * @return bool True if list is empty
+ */
+bool shllist_is_empty(shllist list);
+
+/**
+ * @brief Read the statistics of a list
+ * @details The counters are kept per thread and summed up here, so a
+ *          snapshot taken while other threads use the list may be
+ *          slightly inconsistent. Lock timings are only collected for
+ *          lists created with FLAG_MT_SUPPORT.
+ * @param[in] list a list created with FLAG_STATS
+ * @param[out] stats where to store the statistics
+ * @return int LLIST_SUCCESS if success, LLIST_ERROR if the list doesn't
+ *	   keep statistics
+ */
+int llist_get_stats(llist list, llist_stats *stats);
+
+/**
+ * @brief Install tracing callbacks for all the lists
+ * @details Tracing is compiled in only when the library is built with
+ *          LLIST_TRACE defined (make LLIST_OPTS=-DLLIST_TRACE), otherwise
+ *          the hooks cost nothing and this function fails.
+ * @param[in] hooks the callbacks, NULL to remove them. The structure is not
+ *		copied, it must stay valid until it's replaced or removed.
+ * @return int LLIST_SUCCESS if success, LLIST_NOT_IMPLEMENTED if the
+ *	   library was built without LLIST_TRACE
+ */
+int llist_set_trace_hooks(const llist_trace_hooks *hooks);
+
+/**
+ * @brief Create a ring buffer tracer
+ * @details The tracer keeps the last capacity completed list calls with
+ *          their thread, start time, duration, node count and lock wait.
+ * @param[in] capacity number of calls to keep
+ * @return new tracer if success, NULL on error
+ */
+llist_tracer llist_tracer_create(unsigned int capacity);
+
+/**
+ * @brief Destroy a tracer
+ * @param[in] tracer the tracer to destroy, it must be stopped
+ */
+void llist_tracer_destroy(llist_tracer tracer);
+
+/**
+ * @brief Start recording the list calls of every thread into a tracer
+ * @details This installs the tracer with llist_set_trace_hooks(), replacing
+ *          any other hooks.
+ * @param[in] tracer the tracer to record into
+ * @return int LLIST_SUCCESS if success, LLIST_NOT_IMPLEMENTED if the
+ *	   library was built without LLIST_TRACE
+ */
+int llist_tracer_start(llist_tracer tracer);
+
+/**
+ * @brief Stop recording
+ * @param[in] tracer the tracer that was started
+ * @return int LLIST_SUCCESS if success
+ */
+int llist_tracer_stop(llist_tracer tracer);
+
+/**
+ * @brief Write the recorded calls to a file, oldest first
+ * @details One call per line, tab separated: thread, operation, list,
+ *          start (ns), duration (ns), node count, lock wait (ns).
+ *          The first line is a header starting with '#'.
+ *          Dump a stopped tracer, calls that complete while dumping may be
+ *          torn.
+ * @param[in] tracer the tracer to dump
+ * @param[in] file where to write
+ * @return int LLIST_SUCCESS if success, LLIST_ERROR on a write error
+ */
+int llist_tracer_dump(llist_tracer tracer, FILE *file);
+
 /**
  * @brief check if list is empty
  * @param[in] list the list to operate upon
@@ -256,4 +1212,162 @@ int llist_reverse(llist list);
  */
 bool llist_is_empty(llist list);
 
+/**
+ * @brief Create an external (out of memory) sorter
+ * @param[in] compare_func a function used to compare nodes
+ * @param[in] flags SORT_LIST_ASCENDING or SORT_LIST_DESCENDING
+ * @param[in] mem_limit number of bytes of encoded nodes kept in memory before
+ *		a sorted run is spilled to a temporary file, 0 means no limit
+ * @param[in] encoder used to write nodes to the temporary files
+ * @param[in] decoder used to read nodes back from the temporary files
+ * @param[in] destructor used to release nodes once they were spilled,
+ *		if NULL is provided free() will be used
+ * @return new sorter if success, NULL on error
+ */
+llist_sorter llist_sorter_create(comperator compare_func, int flags,
+				 size_t mem_limit, node_encoder encoder,
+				 node_decoder decoder, node_func destructor);
+
+/**
+ * @brief Destroys a sorter, discarding anything that was not yet sorted
+ * @param[in] sorter the sorter to destroy
+ * @param[in] destroy_nodes true if the nodes still in memory should be destroyed
+ */
+void llist_sorter_destroy(llist_sorter sorter, bool destroy_nodes);
+
+/**
+ * @brief Add a node to a sorter
+ * @param[in] sorter the sorter to operate upon
+ * @param[in] node the node to add, the sorter takes ownership of it
+ * @return int LLIST_SUCCESS if success, on failure the node is still the
+ *	   caller's
+ */
+int llist_sorter_add(llist_sorter sorter, llist_node node);
+
+/**
+ * @brief Move all the nodes of a list into a sorter
+ * @param[in] sorter the sorter to operate upon
+ * @param[in] list the list to drain, it is left empty
+ * @return int LLIST_SUCCESS if success, on failure the nodes left in list
+ *	   are still the caller's
+ */
+int llist_sorter_add_list(llist_sorter sorter, llist list);
+
+/**
+ * @brief Merge everything added so far and append it, sorted, to a list
+ * @param[in] sorter the sorter to operate upon, it is empty afterwards
+ * @param[in] out the list to append the sorted nodes to
+ * @return int LLIST_SUCCESS if success. If out fails to take a node, that
+ *	   error is returned and the nodes not appended yet stay in the
+ *	   sorter: calling llist_sorter_finish() again resumes the merge, no
+ *	   nodes can be added until then. Other errors (reading the runs back)
+ *	   discard what is left.
+ */
+int llist_sorter_finish(llist_sorter sorter, llist out);
+
+/**
+ * @brief Merge everything added so far and stream it, sorted, to a callback
+ * @param[in] sorter the sorter to operate upon, it is empty afterwards
+ * @param[in] func called with every node in order, it owns the node
+ * @param[in] arg passed to func
+ * @return int LLIST_SUCCESS if success
+ */
+int llist_sorter_finish_each(llist_sorter sorter, node_func_arg func,
+			     void *arg);
+
+/**
+ * @brief Create a typed-key list
+ * @details Every node carries an inline key, keys are kept in contiguous
+ *          blocks so that lookups and min/max scans run vectorized (AVX2/SSE)
+ *          kernels when the CPU supports them.
+ * @param[in] key_type type of the keys
+ * @param[in] key_len length of a key, only used for LLIST_KEY_BYTES
+ * @param[in] flags FLAG_MT_SUPPORT for a thread safe list,
+ *		FLAG_NO_SIMD to always use the scalar kernels
+ * @return new list if success, NULL on error
+ */
+llist_keyed llist_keyed_create(E_LLIST_KEY key_type, size_t key_len,
+			       unsigned int flags);
+
+/**
+ * @brief Destroys a typed-key list
+ * @param[in] list The list to destroy
+ * @param[in] destroy_nodes true if the nodes should be destroyed, false if not
+ * @param[in] destructor alternative destructor, if the previous param is true,
+ *			  if NULL is provided standard library c free() will be used
+ */
+void llist_keyed_destroy(llist_keyed list, bool destroy_nodes,
+			 node_func destructor);
+
+/**
+ * @brief Add a node to a typed-key list
+ * @param[in] list the list to operator upon
+ * @param[in] key points to the key of the node, it is copied
+ * @param[in] node the node to add
+ * @param[in] flags ADD_NODE_FRONT or ADD_NODE_REAR
+ * @return int LLIST_SUCCESS if success
+ */
+int llist_keyed_add_node(llist_keyed list, const void *key, llist_node node,
+			 int flags);
+
+/**
+ * @brief Delete the first node matching a key
+ * @param[in] list the list to operator upon
+ * @param[in] key the key to look for
+ * @param[in] destroy_node Should we run a destructor
+ * @param[in] destructor function, if NULL is provided, free() will be used
+ * @return int LLIST_SUCCESS if success
+ */
+int llist_keyed_delete_node(llist_keyed list, const void *key,
+			    bool destroy_node, node_func destructor);
+
+/**
+ * @brief Finds the first node matching a key
+ * @param[in]  list the list to operator upon
+ * @param[in]  key the key to look for
+ * @param[out] found the found node, valid only if LLIST_SUCCESS was returned
+ * @return LLIST_SUCCESS if success
+ */
+int llist_keyed_find_node(llist_keyed list, const void *key,
+			  llist_node *found);
+
+/**
+ * @brief count the nodes matching a key
+ * @param[in] list the list to operator upon
+ * @param[in] key the key to look for
+ * @return int number of matching nodes
+ */
+int llist_keyed_count(llist_keyed list, const void *key);
+
+/**
+ * @brief get the node with the largest key
+ * @param[in] list the list to operate upon
+ * @param[out] max maximum node
+ * @return int LLIST_SUCCESS if success
+ */
+int llist_keyed_get_max(llist_keyed list, llist_node *max);
+
+/**
+ * @brief get the node with the smallest key
+ * @param[in] list the list to operate upon
+ * @param[out] min minimum node
+ * @return int LLIST_SUCCESS if success
+ */
+int llist_keyed_get_min(llist_keyed list, llist_node *min);
+
+/**
+ * @brief return the number of elements in a typed-key list
+ * @param[in] list the list to operate on
+ * @return int  number of elements in the list
+ */
+int llist_keyed_size(llist_keyed list);
+
+/**
+ * @brief operate on each element of a typed-key list
+ * @param[in] list the list to operator upon
+ * @param[in] func the function to perform
+ * @return int LLIST_SUCCESS if success
+ */
+int llist_keyed_for_each(llist_keyed list, node_func func);
+
 #endif /* LLIST_H_ */
@@ -19,12 +19,172 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <pthread.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <stdint.h>
+#include <limits.h>
+
+/*
+ * llist_find_sorted() samples every LLIST_SORTED_INDEX_STRIDE-th node of a
+ * sorted list, a lookup costs O(log(n / stride) + stride) comparisons.
+ */
+#ifndef LLIST_SORTED_INDEX_STRIDE
+#define LLIST_SORTED_INDEX_STRIDE 16
+#endif
+
+/*
+ * Traversal loops can run a lookahead cursor LLIST_PREFETCH_DISTANCE
+ * wrappers ahead of the node being processed and prefetch the wrapper after
+ * it and the payload it points to. The cursor chases the chain itself, so
+ * it only pays off when the per node work is heavy enough to hide that.
+ * It's off (0) unless a build asks for it, no measured gain backs a default.
+ */
+#ifndef LLIST_PREFETCH_DISTANCE
+#define LLIST_PREFETCH_DISTANCE 0
+#endif
+
+/*
+ * Statistics counters are spread over LLIST_STATS_SHARDS cache line aligned
+ * shards, every thread updates its own one, llist_get_stats() sums them up.
+ */
+#ifndef LLIST_STATS_SHARDS
+#define LLIST_STATS_SHARDS 16
+#endif
+
+/*
+ * FLAG_POSITIONAL_INDEX lists keep an indexable skip list over their
+ * wrappers: every level holds about one in LLIST_POSITION_FANOUT entries of
+ * the level below, and each entry knows how many positions there are up to
+ * the next one, so a positional lookup skips whole runs of the list.
+ */
+#ifndef LLIST_POSITION_FANOUT
+#define LLIST_POSITION_FANOUT 4
+#endif
+#define POSITION_LEVELS 16
+
+/*
+ * FLAG_DEFERRED_RECLAIM lists wake their reclaimer thread up early once
+ * LLIST_RECLAIM_BATCH deleted nodes are waiting.
+ */
+#ifndef LLIST_RECLAIM_BATCH
+#define LLIST_RECLAIM_BATCH 256
+#endif
+
+struct __slab;
 
 typedef struct __list_node {
 	llist_node node;
 	struct __list_node *next;
+	struct __slab *slab;    // NULL unless allocated by llist_compact()
 } _list_node;
 
+/*
+ * A block of wrappers allocated in one go by llist_compact(). Wrappers can
+ * migrate between lists (concat, merge...), so the block is released by
+ * whoever frees its last wrapper, not by the list that created it.
+ */
+typedef struct __slab {
+	unsigned int live;      // wrappers still in use, updated atomically
+	_list_node nodes[];
+} _slab;
+
+typedef struct {
+	unsigned long long ops[LLIST_OP_COUNT];
+	unsigned long long scanned[LLIST_OP_COUNT];
+	unsigned long long lock_acquisitions;
+	unsigned long long lock_contended;
+	unsigned long long lock_wait_ns;
+	unsigned long long lock_wait_histogram[LLIST_LOCK_WAIT_BUCKETS];
+	unsigned long long allocations;
+} __attribute__((aligned(64))) _stats_shard;
+
+typedef struct __position {
+	_list_node *wrapper;
+	struct __position *next;        // next entry on the same level
+	struct __position *down;        // same wrapper a level below, NULL on level 0
+	unsigned int width;             // positions up to next, or to the list end
+} _position;
+
+typedef struct {
+	_position heads[POSITION_LEVELS];       // at position -1, before the head
+	unsigned int seed;
+} _position_index;
+
+// Deleted wrappers waiting to be freed, all with the same destructor
+typedef struct __reclaim_batch {
+	bool destroy_nodes;
+	node_func destructor;
+	_list_node *first;
+	_list_node *last;
+	struct __reclaim_batch *next;
+} _reclaim_batch;
+
+typedef struct {
+	// protected by the list write lock
+	_reclaim_batch *head;
+	_reclaim_batch *tail;
+	unsigned int pending;
+
+	// background reclaimer, running is protected by mutex
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	bool running;
+	bool wakeup;            // reclaim now, the batch threshold was crossed
+	unsigned int interval_ms;
+} _reclaim_queue;
+
+// How a list stores its nodes
+typedef enum {
+	LLIST_MODE_CHAIN = 0,   // llist_create(), a chain of wrappers
+	LLIST_MODE_RING,        // llist_create_ring(), a circular array
+	LLIST_MODE_SPSC,        // llist_create_ring() with FLAG_SPSC
+	LLIST_MODE_DEQUE,       // llist_create_ring() with FLAG_WORK_STEALING
+	LLIST_MODE_HEAP,        // llist_create() with FLAG_PRIORITY_QUEUE
+} _llist_mode;
+
+/*
+ * Lamport's single producer / single consumer ring. Positions only ever
+ * grow (slot = position & mask), each side owns one of them and keeps a
+ * cached copy of the other one, so it only reads the other side's cache
+ * line when the cached value says the queue is full (or empty).
+ */
+typedef struct {
+	// producer side
+	unsigned int tail __attribute__((aligned(64)));
+	unsigned int head_cache;
+
+	// consumer side
+	unsigned int head __attribute__((aligned(64)));
+	unsigned int tail_cache;
+
+	// read only
+	unsigned int capacity __attribute__((aligned(64)));
+	unsigned int mask;
+	llist_node *slots;
+} _spsc_queue;
+
+/*
+ * Chase-Lev work stealing deque, as formulated for C11 by Le et al. The
+ * owner pushes and pops at the bottom and only needs a CAS when it races
+ * the thieves for the last node, thieves take from the top with a CAS.
+ * Only the owner grows the array. A thief may still be reading a replaced
+ * array, so replaced arrays are kept until the list is destroyed.
+ */
+typedef struct __deque_array {
+	long size;
+	struct __deque_array *retired;  // the array this one replaced
+	llist_node slots[];
+} _deque_array;
+
+typedef struct {
+	long top __attribute__((aligned(64)));          // thieves
+	long bottom __attribute__((aligned(64)));       // owner
+	_deque_array *array;
+} _ws_deque;
+
 typedef struct {
 	unsigned int count;
 	comperator comp_func;
@@ -32,18 +192,224 @@ typedef struct {
 	_list_node *head;
 	_list_node *tail;
 
+	/*
+	 * LLIST_MODE_RING storage, count slots in use starting at ring_first.
+	 * LLIST_MODE_HEAP keeps a binary heap in the same array, from slot 0.
+	 */
+	unsigned char mode;
+	bool ring_bounded;
+	llist_node *ring;
+	unsigned int ring_capacity;
+	unsigned int ring_first;
+	int heap_order;         // 1 for a max heap, -1 for a min heap
+	_spsc_queue *spsc;      // LLIST_MODE_SPSC storage
+	_ws_deque *deque;       // LLIST_MODE_DEQUE storage
+
+	// set by llist_sort(), dropped by anything that changes the chain
+	int sorted;             // 0 if unknown, otherwise the sort direction
+	_list_node **index;     // every LLIST_SORTED_INDEX_STRIDE-th wrapper
+	unsigned int index_size;
+
+	// FLAG_POSITIONAL_INDEX support, built by the first positional call
+	unsigned char positional;
+	_position_index *positions;
+
+	// FLAG_DEFERRED_RECLAIM support, reclaim is NULL when disabled
+	_reclaim_queue *reclaim;
+
+	// FLAG_STATS support, stats is NULL when disabled
+	_stats_shard *stats;
+	unsigned int peak_size;
+
 	//multi-threading support
 	unsigned char ismt;
 	pthread_rwlockattr_t llist_lock_attr;
 	pthread_rwlock_t llist_lock;
 } _llist;
 
+#if defined(__GNUC__) && (LLIST_PREFETCH_DISTANCE > 0)
+#define prefetch(addr) __builtin_prefetch(addr)
+#else
+#define prefetch(addr) do { } while (0)
+#endif
+
+// Start a lookahead cursor for a loop beginning at iterator
+static inline _list_node *prefetch_start(_list_node *iterator)
+{
+	int i;
+
+	for (i = 0; (i < LLIST_PREFETCH_DISTANCE) && iterator; i++) {
+		prefetch(iterator->node);
+		iterator = iterator->next;
+	}
+
+	return iterator;
+}
+
+// Advance the lookahead cursor by one, once per node of the loop
+static inline _list_node *prefetch_step(_list_node *ahead)
+{
+	if ((LLIST_PREFETCH_DISTANCE == 0) || (ahead == NULL))
+		return NULL;
+
+	prefetch(ahead->next);
+	prefetch(ahead->node);
+
+	return ahead->next;
+}
+
+static unsigned int stats_next_shard;
+static __thread int stats_shard_id = -1;
+
+static inline _stats_shard *stats_shard(_llist *list)
+{
+	if (stats_shard_id < 0)
+		stats_shard_id = __atomic_fetch_add(&stats_next_shard, 1,
+						    __ATOMIC_RELAXED) %
+				 LLIST_STATS_SHARDS;
+
+	return &list->stats[stats_shard_id];
+}
+
+static inline void stats_add(unsigned long long *counter,
+			     unsigned long long value)
+{
+	__atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+#ifdef LLIST_TRACE
+static const llist_trace_hooks *trace_hooks;
+static __thread unsigned long long trace_lock_wait;
+
+static inline const llist_trace_hooks *tracing(void)
+{
+	return __atomic_load_n(&trace_hooks, __ATOMIC_ACQUIRE);
+}
+
+// Called by every public function once its arguments are checked
+static inline void op_begin(llist list, E_LLIST_OP op)
+{
+	const llist_trace_hooks *hooks = tracing();
+
+	if (hooks == NULL)
+		return;
+
+	trace_lock_wait = 0;
+	if (hooks->begin)
+		hooks->begin(op, list, hooks->arg);
+}
+
+static inline void trace_end(llist list, E_LLIST_OP op, unsigned long count)
+{
+	const llist_trace_hooks *hooks = tracing();
+
+	if (hooks && hooks->end)
+		hooks->end(op, list, count, trace_lock_wait, hooks->arg);
+}
+#else
+#define tracing() NULL
+#define op_begin(list, op) do { } while (0)
+#define trace_end(list, op, count) do { } while (0)
+#endif
+
+/*
+ * Called on the way out of every public function that went through
+ * op_begin(), accounts for one call of kind op that visited scanned nodes.
+ */
+static inline void op_end(llist list, E_LLIST_OP op,
+			  unsigned long long scanned)
+{
+	_stats_shard *shard;
+
+	trace_end(list, op, scanned);
+
+	if (((_llist *) list)->stats == NULL)
+		return;
+
+	shard = stats_shard((_llist *) list);
+	stats_add(&shard->ops[op], 1);
+	if (scanned)
+		stats_add(&shard->scanned[op], scanned);
+}
+
+static inline void stat_alloc(llist list)
+{
+	if (((_llist *) list)->stats)
+		stats_add(&stats_shard((_llist *) list)->allocations, 1);
+}
+
+/*
+ * Peak size for the lock free lists, which don't go through list_changed().
+ * Only their single producer / owner calls it.
+ */
+static inline void stat_peak(_llist *list, unsigned int size)
+{
+	if (list->stats && (size > list->peak_size))
+		__atomic_store_n(&list->peak_size, size, __ATOMIC_RELAXED);
+}
+
+/*
+ * Take the list lock and record how long that took, for the statistics and
+ * the tracer. The lock is tried first so that the common uncontended case
+ * doesn't read the clock.
+ */
+static int timed_lock(_llist *list, int (*trylock)(pthread_rwlock_t *),
+		      int (*lock)(pthread_rwlock_t *))
+{
+	struct timespec start, end;
+	unsigned long long wait = 0;
+	_stats_shard *shard;
+	unsigned int bucket = 0;
+	int rc;
+
+	rc = trylock(&list->llist_lock);
+	if (rc == EBUSY) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		rc = lock(&list->llist_lock);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+
+		wait = (end.tv_sec - start.tv_sec) * 1000000000ULL +
+		       end.tv_nsec - start.tv_nsec;
+	}
+
+	if (rc)
+		return rc;
+
+#ifdef LLIST_TRACE
+	trace_lock_wait += wait;
+#endif
+
+	if (list->stats == NULL)
+		return 0;
+
+	shard = stats_shard(list);
+	stats_add(&shard->lock_acquisitions, 1);
+
+	if (wait) {
+		bucket = 63 - __builtin_clzll(wait);
+		if (bucket >= LLIST_LOCK_WAIT_BUCKETS)
+			bucket = LLIST_LOCK_WAIT_BUCKETS - 1;
+
+		stats_add(&shard->lock_contended, 1);
+		stats_add(&shard->lock_wait_ns, wait);
+	}
+	stats_add(&shard->lock_wait_histogram[bucket], 1);
+
+	return 0;
+}
+
 static inline int write_lock(llist list)
 {
 	int rc = 0;
 
-	if (((_llist *)list)->ismt)
-		rc = pthread_rwlock_wrlock(&((_llist *) list)->llist_lock);
+	if (((_llist *)list)->ismt) {
+		if (((_llist *)list)->stats || tracing())
+			rc = timed_lock((_llist *) list,
+					pthread_rwlock_trywrlock,
+					pthread_rwlock_wrlock);
+		else
+			rc = pthread_rwlock_wrlock(&((_llist *) list)->llist_lock);
+	}
 
 	return rc;
 }
@@ -52,8 +418,14 @@ static inline int read_lock(llist list)
 {
 	int rc = 0;
 
-	if (((_llist *)list)->ismt)
-		rc = pthread_rwlock_rdlock(&((_llist *) list)->llist_lock);
+	if (((_llist *)list)->ismt) {
+		if (((_llist *)list)->stats || tracing())
+			rc = timed_lock((_llist *) list,
+					pthread_rwlock_tryrdlock,
+					pthread_rwlock_rdlock);
+		else
+			rc = pthread_rwlock_rdlock(&((_llist *) list)->llist_lock);
+	}
 
 	return rc;
 }
@@ -64,6 +436,82 @@ static inline void unlock(llist list)
 		pthread_rwlock_unlock(&((_llist *) list)->llist_lock);
 }
 
+static inline _list_node *alloc_wrapper(llist list)
+{
+	_list_node *node_wrapper = malloc(sizeof(_list_node));
+
+	if (node_wrapper) {
+		node_wrapper->slab = NULL;
+		stat_alloc(list);
+	}
+
+	return node_wrapper;
+}
+
+static inline void free_wrapper(_list_node *node_wrapper)
+{
+	_slab *slab = node_wrapper->slab;
+
+	if (slab == NULL)
+		free(node_wrapper);
+	else if (__atomic_sub_fetch(&slab->live, 1, __ATOMIC_ACQ_REL) == 0)
+		free(slab);
+}
+
+static void free_positions(_position_index *positions)
+{
+	_position *entry, *next;
+	int level;
+
+	if (positions == NULL)
+		return;
+
+	for (level = 0; level < POSITION_LEVELS; level++) {
+		for (entry = positions->heads[level].next; entry; entry = next) {
+			next = entry->next;
+			free(entry);
+		}
+	}
+
+	free(positions);
+}
+
+static inline void drop_positions(_llist *list)
+{
+	free_positions(list->positions);
+	list->positions = NULL;
+}
+
+/*
+ * Same as list_modified(), for the calls that keep the position index up to
+ * date themselves.
+ */
+static inline void list_changed(llist list)
+{
+	_llist *thelist = (_llist *) list;
+
+	thelist->sorted = 0;
+	if (thelist->count > thelist->peak_size)
+		__atomic_store_n(&thelist->peak_size, thelist->count,
+				 __ATOMIC_RELAXED);
+
+	if (thelist->index) {
+		free(thelist->index);
+		thelist->index = NULL;
+		thelist->index_size = 0;
+	}
+}
+
+/*
+ * Must be called (under the write lock) by everything that changes the
+ * chain, it drops what was derived from the previous node order.
+ */
+static inline void list_modified(llist list)
+{
+	list_changed(list);
+	drop_positions((_llist *) list);
+}
+
 /*
  * Lock two lists for writing in a fixed (address) order so that concurrent
  * concat/merge calls on the same pair can't deadlock (AB/BA).
@@ -88,19 +536,134 @@ static inline void unlock_two(llist a, llist b)
 		unlock(b);
 }
 
+// Same as write_lock_two() for three different lists
+static inline void write_lock_three(llist a, llist b, llist c)
+{
+	llist temp;
+
+	if (a > b) {
+		temp = a;
+		a = b;
+		b = temp;
+	}
+	if (b > c) {
+		temp = b;
+		b = c;
+		c = temp;
+	}
+	if (a > b) {
+		temp = a;
+		a = b;
+		b = temp;
+	}
+
+	write_lock(a);
+	write_lock(b);
+	write_lock(c);
+}
+
+static inline void unlock_three(llist a, llist b, llist c)
+{
+	unlock(a);
+	unlock(b);
+	unlock(c);
+}
+
+/*
+ * Most calls only know how to deal with a chain of wrappers, they return
+ * LLIST_NOT_IMPLEMENTED (or NULL) for lists stored any other way.
+ */
+static inline bool chained(llist list)
+{
+	return ((_llist *) list)->mode == LLIST_MODE_CHAIN;
+}
+
+// Lists keeping their nodes in the ring array
+static inline bool in_array(llist list)
+{
+	return (((_llist *) list)->mode == LLIST_MODE_RING) ||
+	       (((_llist *) list)->mode == LLIST_MODE_HEAP);
+}
+
+// Lists whose storage isn't protected by the list lock
+static inline bool lock_free(llist list)
+{
+	return (((_llist *) list)->mode == LLIST_MODE_SPSC) ||
+	       (((_llist *) list)->mode == LLIST_MODE_DEQUE);
+}
+
+// Slot of the i-th node (i < capacity) of a LLIST_MODE_RING list
+static inline llist_node *ring_slot(_llist *list, unsigned int i)
+{
+	i += list->ring_first;
+	if (i >= list->ring_capacity)
+		i -= list->ring_capacity;
+
+	return &list->ring[i];
+}
+
 /* Helper functions - not to be exported */
 static _list_node *listsort(_list_node *list, _list_node **updated_tail,
 			    comperator cmp, int flags);
+static void build_sorted_index(_llist *list);
+static void position_insert(_llist *list, unsigned int index,
+			    _list_node *wrapper);
+static void position_remove(_llist *list, unsigned int index);
+
+static _reclaim_queue *alloc_reclaim(void)
+{
+	_reclaim_queue *queue = malloc(sizeof(_reclaim_queue));
+
+	if (queue == NULL)
+		return NULL;
+
+	if (pthread_mutex_init(&queue->mutex, NULL)) {
+		free(queue);
+		return NULL;
+	}
+
+	if (pthread_cond_init(&queue->cond, NULL)) {
+		pthread_mutex_destroy(&queue->mutex);
+		free(queue);
+		return NULL;
+	}
+
+	queue->head = queue->tail = NULL;
+	queue->pending = 0;
+	queue->running = false;
+	queue->wakeup = false;
+	queue->interval_ms = 0;
+
+	return queue;
+}
+
+// The queue must be drained and its reclaimer stopped
+static void free_reclaim(_reclaim_queue *queue)
+{
+	if (queue == NULL)
+		return;
+
+	pthread_cond_destroy(&queue->cond);
+	pthread_mutex_destroy(&queue->mutex);
+	free(queue);
+}
 
 llist llist_create(comperator compare_func, equal equal_func, unsigned int flags)
 {
 	_llist *new_list;
 	int rc = 0;
 
+	if ((flags & FLAG_PRIORITY_QUEUE) && (compare_func == NULL))
+		return NULL;
+
+	op_begin(NULL, LLIST_OP_OTHER);
+
 	new_list = malloc(sizeof(_llist));
 
-	if (new_list == NULL)
+	if (new_list == NULL) {
+		trace_end(NULL, LLIST_OP_OTHER, 0);
 		return NULL;
+	}
 
 // These can be NULL, I don't care...
 	new_list->equal_func = equal_func;
@@ -110,465 +673,3087 @@ llist llist_create(comperator compare_func, equal equal_func, unsigned int flags
 	new_list->count = 0;
 	new_list->head = NULL;
 	new_list->tail = NULL;
+	new_list->mode = LLIST_MODE_CHAIN;
+	new_list->ring_bounded = false;
+	new_list->ring = NULL;
+	new_list->ring_capacity = 0;
+	new_list->ring_first = 0;
+	new_list->heap_order = (flags & FLAG_PRIORITY_MAX) ? 1 : -1;
+	new_list->spsc = NULL;
+	new_list->deque = NULL;
+	new_list->sorted = 0;
+	new_list->index = NULL;
+	new_list->index_size = 0;
+	new_list->positional = !!(flags & FLAG_POSITIONAL_INDEX);
+	new_list->positions = NULL;
+	new_list->reclaim = NULL;
+	new_list->stats = NULL;
+	new_list->peak_size = 0;
+
+	// the heap array is allocated by the first push
+	if (flags & FLAG_PRIORITY_QUEUE)
+		new_list->mode = LLIST_MODE_HEAP;
+
+	if (flags & FLAG_STATS) {
+		if (posix_memalign((void **) &new_list->stats,
+				   __alignof__(_stats_shard),
+				   LLIST_STATS_SHARDS * sizeof(_stats_shard))) {
+			free(new_list);
+			trace_end(NULL, LLIST_OP_OTHER, 0);
+			return NULL;
+		}
+		memset(new_list->stats, 0,
+		       LLIST_STATS_SHARDS * sizeof(_stats_shard));
+	}
+
+	if (flags & FLAG_DEFERRED_RECLAIM) {
+		new_list->reclaim = alloc_reclaim();
+		if (new_list->reclaim == NULL) {
+			free(new_list->stats);
+			free(new_list);
+			trace_end(NULL, LLIST_OP_OTHER, 0);
+			return NULL;
+		}
+	}
 
 	new_list->ismt = false;
 	if (flags & FLAG_MT_SUPPORT) {
 		new_list->ismt = true;
+		rc = pthread_rwlockattr_init(&new_list->llist_lock_attr);
+		if (rc != 0) {
+			free_reclaim(new_list->reclaim);
+			free(new_list->stats);
+			free(new_list);
+			trace_end(NULL, LLIST_OP_OTHER, 0);
+			return NULL;
+		}
 		rc = pthread_rwlockattr_setpshared(&new_list->llist_lock_attr,
 						   PTHREAD_PROCESS_PRIVATE);
 		if (rc != 0) {
+			pthread_rwlockattr_destroy(&new_list->llist_lock_attr);
+			free_reclaim(new_list->reclaim);
+			free(new_list->stats);
 			free(new_list);
+			trace_end(NULL, LLIST_OP_OTHER, 0);
 			return NULL;
 		}
 		rc = pthread_rwlock_init(&new_list->llist_lock,
 					 &new_list->llist_lock_attr);
 		if (rc != 0) {
 			pthread_rwlockattr_destroy(&new_list->llist_lock_attr);
+			free_reclaim(new_list->reclaim);
+			free(new_list->stats);
 			free(new_list);
+			trace_end(NULL, LLIST_OP_OTHER, 0);
 			return NULL;
 		}
 	}
 
+	trace_end(new_list, LLIST_OP_OTHER, 0);
+
 	return new_list;
 }
 
-void llist_destroy(llist list, bool destroy_nodes, node_func destructor)
+static _spsc_queue *alloc_spsc(unsigned int capacity)
 {
-	_list_node *iterator;
-	_list_node *next;
+	_spsc_queue *queue;
+	unsigned int size = 1;
 
-	if (list == NULL)
-		return;
+	while (size < capacity)
+		size <<= 1;
 
-	// Delete the data contained in the nodes
-	iterator = ((_llist *) list)->head;
+	if (posix_memalign((void **) &queue, __alignof__(_spsc_queue),
+			   sizeof(_spsc_queue)))
+		return NULL;
 
-	while (iterator != NULL) {
+	queue->slots = malloc(size * sizeof(llist_node));
+	if (queue->slots == NULL) {
+		free(queue);
+		return NULL;
+	}
 
-		if (destroy_nodes) {
-			if (destructor)
-				destructor(iterator->node);
-			else
-				free(iterator->node);
-		}
+	queue->tail = queue->head_cache = 0;
+	queue->head = queue->tail_cache = 0;
+	queue->capacity = capacity;
+	queue->mask = size - 1;
 
-		next = iterator->next;
-		free(iterator);    // Delete's the container
-		iterator = next;
-	}
+	return queue;
+}
 
-	if (true == ((_llist *)list)->ismt) {
-		//release any thread related resource, just try to destroy no use checking return code
-		pthread_rwlockattr_destroy(&((_llist *) list)->llist_lock_attr);
-		pthread_rwlock_destroy(&((_llist *) list)->llist_lock);
+// Nobody may be using the queue anymore
+static void free_spsc(_spsc_queue *queue, bool destroy_nodes,
+		      node_func destructor)
+{
+	unsigned int pos;
+
+	if (queue == NULL)
+		return;
+
+	for (pos = queue->head; destroy_nodes && (pos != queue->tail); pos++) {
+		if (destructor)
+			destructor(queue->slots[pos & queue->mask]);
+		else
+			free(queue->slots[pos & queue->mask]);
 	}
-	//release the list
-	free(list);
+
+	free(queue->slots);
+	free(queue);
 }
 
-int llist_size(llist list)
+// Producer side
+static int spsc_add_node(_llist *list, llist_node node, int flags)
 {
-	unsigned int retval = 0;
+	_spsc_queue *queue = list->spsc;
+	unsigned int tail;
+
+	// the front belongs to the consumer
+	if (flags & ADD_NODE_FRONT)
+		return LLIST_NOT_IMPLEMENTED;
+
+	op_begin(list, LLIST_OP_ADD);
+
+	tail = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+	if (tail - queue->head_cache == queue->capacity) {
+		queue->head_cache = __atomic_load_n(&queue->head,
+						    __ATOMIC_ACQUIRE);
+		if (tail - queue->head_cache == queue->capacity) {
+			op_end(list, LLIST_OP_ADD, 0);
+			return LLIST_FULL;
+		}
+	}
 
-	if (list == NULL)
-		return 0;
+	queue->slots[tail & queue->mask] = node;
+	__atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
 
-	if (read_lock(list))
-		return LLIST_MULTITHREAD_ISSUE;
+	// head_cache may be stale, only read the real head for statistics
+	if (list->stats)
+		stat_peak(list, tail + 1 - __atomic_load_n(&queue->head,
+							   __ATOMIC_ACQUIRE));
 
-	//read only critical section
-	retval = ((_llist *) list)->count;
-
-	unlock(list);
+	op_end(list, LLIST_OP_ADD, 0);
 
-	return retval;
+	return LLIST_SUCCESS;
 }
 
-int llist_add_node(llist list, llist_node node, int flags)
+// Consumer side, advance tells whether to pop or to peek
+static llist_node spsc_take(_llist *list, bool advance)
 {
-	_list_node *node_wrapper = NULL;
+	_spsc_queue *queue = list->spsc;
+	E_LLIST_OP op = advance ? LLIST_OP_POP : LLIST_OP_READ;
+	llist_node node;
+	unsigned int head;
 
-	if (list == NULL)
-		return LLIST_NULL_ARGUMENT;
-	//
-	//write critical section
-	node_wrapper = malloc(sizeof(_list_node));
-	if (node_wrapper == NULL)
-		return LLIST_MALLOC_ERROR;
+	op_begin(list, op);
 
-	if (write_lock(list)) {
-		free(node_wrapper);
-		return LLIST_MULTITHREAD_ISSUE;
+	head = __atomic_load_n(&queue->head, __ATOMIC_RELAXED);
+	if (head == queue->tail_cache) {
+		queue->tail_cache = __atomic_load_n(&queue->tail,
+						    __ATOMIC_ACQUIRE);
+		if (head == queue->tail_cache) {
+			op_end(list, op, 0);
+			return NULL;
+		}
 	}
 
-	node_wrapper->node = node;
-	((_llist *) list)->count++;
-
-	if (((_llist *) list)->head == NULL) {      // Adding the first node, update head and tail to point to that node
-		node_wrapper->next = NULL;
-		((_llist *) list)->head =
-			((_llist *) list)->tail = node_wrapper;
-	} else if (flags & ADD_NODE_FRONT) {
-		node_wrapper->next = ((_llist *) list)->head;
-		((_llist *) list)->head = node_wrapper;
-	} else { // add node in the rear
-		node_wrapper->next = NULL;
-		((_llist *) list)->tail->next = node_wrapper;
-		((_llist *) list)->tail = node_wrapper;
-	}
+	node = queue->slots[head & queue->mask];
+	if (advance)
+		__atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
 
-	unlock(list);
+	op_end(list, op, 0);
 
-	return LLIST_SUCCESS;
+	return node;
 }
 
-int llist_delete_node(llist list, llist_node node,
-		      bool destroy_node, node_func destructor)
+// Producer side
+static llist_node spsc_get_tail(_llist *list)
 {
-	_list_node *iterator;
-	_list_node *temp;
-	equal actual_equal;
+	_spsc_queue *queue = list->spsc;
+	llist_node node = NULL;
+	unsigned int tail;
 
-	if ((list == NULL) || (node == NULL))
-		return LLIST_NULL_ARGUMENT;
+	op_begin(list, LLIST_OP_READ);
 
-	actual_equal = ((_llist *) list)->equal_func;
+	tail = __atomic_load_n(&queue->tail, __ATOMIC_RELAXED);
+	if (tail != __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE))
+		node = queue->slots[(tail - 1) & queue->mask];
 
-	if (actual_equal == NULL)
-		return LLIST_EQUAL_MISSING;
+	op_end(list, LLIST_OP_READ, 0);
 
-	if (write_lock(list))
-		return LLIST_MULTITHREAD_ISSUE;
+	return node;
+}
 
-	iterator = ((_llist *) list)->head;
+// Either side, a snapshot that may be stale by the time it is returned
+static unsigned int spsc_size(_spsc_queue *queue)
+{
+	unsigned int head, size;
 
-	if (iterator == NULL) {
-		unlock(list);
-		return LLIST_NODE_NOT_FOUND;
-	}
+	// head first, the tail can only be ahead of it
+	head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+	size = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE) - head;
 
-	// is it the first node ?
-	if (actual_equal(iterator->node, node)) {
-		((_llist *) list)->head = iterator->next;
-		((_llist *) list)->count--;
+	return (size > queue->capacity) ? queue->capacity : size;
+}
 
-		if (((_llist *) list)->count == 0) {
-			/*
-			 *  if we deleted the last node, we need to reset the tail
-			 *  also, because the last node must be the head (and tail)
-			 */
-			((_llist *) list)->tail = NULL;
-		}
 
-		if (destroy_node) {
-			if (destructor)
-				destructor(iterator->node);
-			else
-				free(iterator->node);
-		}
+static _deque_array *alloc_deque_array(long size)
+{
+	_deque_array *array;
 
-		free(iterator);
-		unlock(list);
-		return LLIST_SUCCESS;
-	}
+	array = malloc(sizeof(_deque_array) + size * sizeof(llist_node));
+	if (array == NULL)
+		return NULL;
 
-	while (iterator->next != NULL) {
-		if (actual_equal(iterator->next->node, node)) {
-			// found it
-			temp = iterator->next;
-			iterator->next = temp->next;
+	array->size = size;
+	array->retired = NULL;
 
-			// if we unlinked the tail, the tail is now the predecessor
-			if (temp == ((_llist *) list)->tail)
-				((_llist *) list)->tail = iterator;
+	return array;
+}
 
-			((_llist *) list)->count--;
+static _ws_deque *alloc_deque(unsigned int capacity)
+{
+	_ws_deque *deque;
+	long size = 1;
 
-			if (destroy_node) {
-				if (destructor)
-					destructor(temp->node);
-				else
-					free(temp->node);
-			}
+	while (size < capacity)
+		size <<= 1;
 
-			free(temp);
-			unlock(list);
-			return LLIST_SUCCESS;
-		}
+	if (posix_memalign((void **) &deque, __alignof__(_ws_deque),
+			   sizeof(_ws_deque)))
+		return NULL;
 
-		iterator = iterator->next;
+	deque->array = alloc_deque_array(size);
+	if (deque->array == NULL) {
+		free(deque);
+		return NULL;
 	}
 
-	unlock(list);
+	deque->top = deque->bottom = 0;
 
-	return LLIST_NODE_NOT_FOUND;
+	return deque;
 }
 
-int llist_for_each(llist list, node_func func)
+// Nobody may be using the deque anymore
+static void free_deque(_ws_deque *deque, bool destroy_nodes,
+		       node_func destructor)
 {
-	_list_node *iterator;
-
-	if ((list == NULL) || (func == NULL))
-		return LLIST_NULL_ARGUMENT;
+	_deque_array *array, *retired;
+	long i;
 
-	read_lock(list);
+	if (deque == NULL)
+		return;
 
-	iterator = ((_llist *) list)->head;
+	array = deque->array;
+	for (i = deque->top; destroy_nodes && (i < deque->bottom); i++) {
+		if (destructor)
+			destructor(array->slots[i & (array->size - 1)]);
+		else
+			free(array->slots[i & (array->size - 1)]);
+	}
 
-	while (iterator != NULL) {
-		func(iterator->node);
-		iterator = iterator->next;
+	for (; array; array = retired) {
+		retired = array->retired;
+		free(array);
 	}
 
-	unlock(list);
+	free(deque);
+}
 
-	return LLIST_SUCCESS;
+static inline llist_node deque_slot(_deque_array *array, long i)
+{
+	return __atomic_load_n(&array->slots[i & (array->size - 1)],
+			       __ATOMIC_RELAXED);
 }
 
-int llist_for_each_arg(llist list, node_func_arg func, void *arg)
+// Owner side
+static int deque_push(_llist *list, llist_node node)
 {
-	_list_node *iterator;
+	_ws_deque *deque = list->deque;
+	_deque_array *array, *bigger;
+	long bottom, top, i;
 
-	if ((list == NULL) || (func == NULL))
-		return LLIST_NULL_ARGUMENT;
+	op_begin(list, LLIST_OP_ADD);
 
-	read_lock(list);
+	bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+	top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+	array = __atomic_load_n(&deque->array, __ATOMIC_RELAXED);
 
-	iterator = ((_llist *) list)->head;
+	if (bottom - top > array->size - 1) {
+		bigger = alloc_deque_array(2 * array->size);
+		if (bigger == NULL) {
+			op_end(list, LLIST_OP_ADD, 0);
+			return LLIST_MALLOC_ERROR;
+		}
 
-	while (iterator != NULL) {
-		func(iterator->node, arg);
-		iterator = iterator->next;
+		for (i = top; i < bottom; i++)
+			bigger->slots[i & (bigger->size - 1)] =
+				deque_slot(array, i);
+
+		// a thief may still be reading the old one
+		bigger->retired = array;
+		__atomic_store_n(&deque->array, bigger, __ATOMIC_RELEASE);
+		array = bigger;
+		stat_alloc(list);
 	}
 
-	unlock(list);
+	__atomic_store_n(&array->slots[bottom & (array->size - 1)], node,
+			 __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+	stat_peak(list, bottom + 1 - top);
+
+	op_end(list, LLIST_OP_ADD, 0);
 
 	return LLIST_SUCCESS;
 }
 
-int llist_insert_node(llist list, llist_node new_node, llist_node pos_node,
-		      int flags)
+// Owner side, takes back the most recently pushed node
+static llist_node deque_pop(_llist *list)
 {
-	_list_node *iterator;
-	_list_node *node_wrapper = NULL;
-
-	if ((list == NULL) || (new_node == NULL) || (pos_node == NULL))
-		return LLIST_NULL_ARGUMENT;
-
-	node_wrapper = malloc(sizeof(_list_node));
-	if (node_wrapper == NULL)
-		return LLIST_MALLOC_ERROR;
+	_ws_deque *deque = list->deque;
+	_deque_array *array;
+	llist_node node = NULL;
+	long bottom, top;
 
-	node_wrapper->node = new_node;
+	op_begin(list, LLIST_OP_POP);
 
-	write_lock(list);
+	bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+	array = __atomic_load_n(&deque->array, __ATOMIC_RELAXED);
+	__atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
 
-	iterator = ((_llist *) list)->head;
+	if (top <= bottom) {
+		node = deque_slot(array, bottom);
 
-	if (iterator == NULL) {
-		// empty list, pos_node cannot exist in it
-		unlock(list);
-		free(node_wrapper);
-		return LLIST_NODE_NOT_FOUND;
+		// the last node, race the thieves for it
+		if ((top == bottom) &&
+		    !__atomic_compare_exchange_n(&deque->top, &top, top + 1,
+						 false, __ATOMIC_SEQ_CST,
+						 __ATOMIC_RELAXED))
+			node = NULL;
 	}
 
-	if (iterator->node == pos_node) {
-		// it's the first node
+	if (top >= bottom)
+		__atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
 
-		if (flags & ADD_NODE_BEFORE) {
-			node_wrapper->next = iterator;
-			((_llist *) list)->head = node_wrapper;
-		} else {
-			node_wrapper->next = iterator->next;
-			iterator->next = node_wrapper;
-			// inserting after the only node makes a new tail
-			if (node_wrapper->next == NULL)
-				((_llist *) list)->tail = node_wrapper;
-		}
-		((_llist *) list)->count++;
-		unlock(list);
+	op_end(list, LLIST_OP_POP, 0);
 
-		return LLIST_SUCCESS;
-	}
+	return node;
+}
 
-	while (iterator->next != NULL) {
-		if (iterator->next->node == pos_node) {
-			if (flags & ADD_NODE_BEFORE) {
-				node_wrapper->next = iterator->next;
-				iterator->next = node_wrapper;
-			} else {
-				iterator = iterator->next;
-				// now we stand on the pos node
-				node_wrapper->next = iterator->next;
-				iterator->next = node_wrapper;
-				// inserting after the tail makes a new tail
-				if (node_wrapper->next == NULL)
-					((_llist *) list)->tail = node_wrapper;
-			}
-			((_llist *) list)->count++;
-			unlock(list);
-			return LLIST_SUCCESS;
-		}
+// Either side, a snapshot that may be stale by the time it is returned
+static unsigned int deque_size(_ws_deque *deque)
+{
+	long top, bottom;
 
-		iterator = iterator->next;
-	}
+	top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+	bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
 
-	// pos_node was not found in the list
-	unlock(list);
-	free(node_wrapper);
-	return LLIST_NODE_NOT_FOUND;
+	return (bottom > top) ? bottom - top : 0;
 }
 
-int llist_find_node(llist list, void *data, llist_node *found)
+int llist_steal(llist list, llist_node *node)
 {
-	_list_node *iterator;
-	equal actual_equal;
+	_llist *thelist = (_llist *) list;
+	_ws_deque *deque;
+	_deque_array *array;
+	unsigned int attempts = 0;
+	long top, bottom;
 
-	if (list == NULL)
+	if ((list == NULL) || (node == NULL))
 		return LLIST_NULL_ARGUMENT;
 
-	actual_equal = ((_llist *) list)->equal_func;
+	if (thelist->mode != LLIST_MODE_DEQUE)
+		return LLIST_NOT_IMPLEMENTED;
 
-	if (actual_equal == NULL) {
-		return LLIST_EQUAL_MISSING;
-	}
+	deque = thelist->deque;
+	op_begin(list, LLIST_OP_POP);
 
-	read_lock(list);
+	// lock free, retry as long as other thieves (or the owner) win
+	for (;;) {
+		attempts++;
+		top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
 
-	iterator = ((_llist *) list)->head;
-	while (iterator != NULL) {
-		if (actual_equal(iterator->node, data)) {
-			*found = iterator->node;
-			unlock(list);
-			return LLIST_SUCCESS;
+		if (top >= bottom) {
+			op_end(list, LLIST_OP_POP, attempts);
+			return LLIST_NODE_NOT_FOUND;
 		}
-		iterator = iterator->next;
+
+		array = __atomic_load_n(&deque->array, __ATOMIC_ACQUIRE);
+		*node = deque_slot(array, top);
+
+		if (__atomic_compare_exchange_n(&deque->top, &top, top + 1,
+						false, __ATOMIC_SEQ_CST,
+						__ATOMIC_RELAXED))
+			break;
 	}
 
-	unlock(list);
+	op_end(list, LLIST_OP_POP, attempts);
 
-	// Didn't find the node
-	return LLIST_NODE_NOT_FOUND;
+	return LLIST_SUCCESS;
 }
 
-llist_node llist_get_head(llist list)
+llist llist_create_ring(comperator compare_func, equal equal_func,
+			unsigned int capacity, unsigned int flags)
 {
-	llist_node node = NULL;
+	_llist *new_list;
 
-	if (list == NULL)
+	if (capacity == 0)
 		return NULL;
 
-	read_lock(list);
+	if (flags & (FLAG_SPSC | FLAG_WORK_STEALING)) {
+		// these never take the list lock
+		if ((capacity > UINT_MAX / 2 + 1) ||
+		    ((flags & FLAG_SPSC) && (flags & FLAG_WORK_STEALING)))
+			return NULL;
 
-	if (((_llist *) list)->head)      // there's at least one node
-		node = ((_llist *) list)->head->node;
+		new_list = llist_create(compare_func, equal_func,
+					flags & FLAG_STATS);
+		if (new_list == NULL)
+			return NULL;
 
-	unlock(list);
+		if (flags & FLAG_SPSC) {
+			new_list->spsc = alloc_spsc(capacity);
+			new_list->mode = LLIST_MODE_SPSC;
+		} else {
+			new_list->deque = alloc_deque(capacity);
+			new_list->mode = LLIST_MODE_DEQUE;
+		}
 
-	return node;
-}
+		if ((new_list->spsc == NULL) && (new_list->deque == NULL)) {
+			llist_destroy(new_list, false, NULL);
+			return NULL;
+		}
 
-llist_node llist_get_tail(llist list)
-{
-	llist_node node = NULL;
+		stat_alloc(new_list);
 
-	if (list == NULL)
+		return new_list;
+	}
+
+	new_list = llist_create(compare_func, equal_func,
+				flags & (FLAG_MT_SUPPORT | FLAG_STATS));
+	if (new_list == NULL)
 		return NULL;
 
-	read_lock(list);
+	new_list->ring = malloc(capacity * sizeof(llist_node));
+	if (new_list->ring == NULL) {
+		llist_destroy(new_list, false, NULL);
+		return NULL;
+	}
 
-	if (((_llist *) list)->tail)      // there's at least one node
-		node = ((_llist *) list)->tail->node;
+	stat_alloc(new_list);
 
-	unlock(list);
+	new_list->mode = LLIST_MODE_RING;
+	new_list->ring_bounded = !!(flags & FLAG_RING_BOUNDED);
+	new_list->ring_capacity = capacity;
 
-	return node;
+	return new_list;
 }
 
-int llist_push(llist list, llist_node node)
+/*
+ * Double the capacity of a full ring, unwrapping it, under the write lock.
+ * A priority queue starts without any array.
+ */
+static int ring_grow(_llist *list)
 {
-	return llist_add_node(list, node, ADD_NODE_FRONT);
-}
+	llist_node *ring;
+	unsigned int i, capacity;
 
-llist_node llist_peek(llist list)
-{
-	return llist_get_head(list);
-}
+	if (list->ring_capacity > UINT_MAX / 2)
+		return LLIST_MALLOC_ERROR;
 
-llist_node llist_pop(llist list)
-{
-	llist_node tempnode = NULL;
+	capacity = list->ring_capacity ? 2 * list->ring_capacity : 16;
+	ring = malloc(capacity * sizeof(llist_node));
+	if (ring == NULL)
+		return LLIST_MALLOC_ERROR;
+
+	stat_alloc(list);
+
+	for (i = 0; i < list->count; i++)
+		ring[i] = *ring_slot(list, i);
+
+	free(list->ring);
+	list->ring = ring;
+	list->ring_capacity = capacity;
+	list->ring_first = 0;
+
+	return LLIST_SUCCESS;
+}
+
+static int ring_add_node(_llist *list, llist_node node, int flags)
+{
+	int rc = LLIST_SUCCESS;
+
+	op_begin(list, LLIST_OP_ADD);
+
+	if (write_lock(list)) {
+		op_end(list, LLIST_OP_ADD, 0);
+		return LLIST_MULTITHREAD_ISSUE;
+	}
+
+	if (list->count == list->ring_capacity)
+		rc = list->ring_bounded ? LLIST_FULL : ring_grow(list);
+
+	if (rc == LLIST_SUCCESS) {
+		if (flags & ADD_NODE_FRONT) {
+			list->ring_first = list->ring_first ?
+					   list->ring_first - 1 :
+					   list->ring_capacity - 1;
+			list->ring[list->ring_first] = node;
+		} else {
+			*ring_slot(list, list->count) = node;
+		}
+
+		list->count++;
+		list_modified(list);
+	}
+
+	unlock(list);
+	op_end(list, LLIST_OP_ADD, 0);
+
+	return rc;
+}
+
+static llist_node ring_pop(_llist *list)
+{
+	llist_node node = NULL;
+
+	op_begin(list, LLIST_OP_POP);
+	write_lock(list);
+
+	if (list->count) {
+		node = list->ring[list->ring_first];
+		list->ring_first = (list->ring_first + 1 == list->ring_capacity) ?
+				   0 : list->ring_first + 1;
+		list->count--;
+		list_modified(list);
+	}
+
+	unlock(list);
+	op_end(list, LLIST_OP_POP, 0);
+
+	return node;
+}
+
+static int pq_add_node(_llist *list, llist_node node)
+{
+	llist_node *heap;
+	unsigned int i, parent, levels = 0;
+	int rc = LLIST_SUCCESS;
+
+	op_begin(list, LLIST_OP_ADD);
+
+	if (write_lock(list)) {
+		op_end(list, LLIST_OP_ADD, 0);
+		return LLIST_MULTITHREAD_ISSUE;
+	}
+
+	if (list->count == list->ring_capacity)
+		rc = ring_grow(list);
+
+	if (rc == LLIST_SUCCESS) {
+		// sift the hole at the end up to where node belongs
+		heap = list->ring;
+		for (i = list->count; i > 0; i = parent, levels++) {
+			parent = (i - 1) / 2;
+			if (list->heap_order *
+			    list->comp_func(node, heap[parent]) <= 0)
+				break;
+			heap[i] = heap[parent];
+		}
+		heap[i] = node;
+
+		list->count++;
+		list_modified(list);
+	}
+
+	unlock(list);
+	op_end(list, LLIST_OP_ADD, levels);
+
+	return rc;
+}
+
+static llist_node pq_pop(_llist *list)
+{
+	llist_node *heap, node = NULL, last;
+	unsigned int i = 0, child, levels = 0;
+
+	op_begin(list, LLIST_OP_POP);
+	write_lock(list);
+
+	if (list->count) {
+		heap = list->ring;
+		node = heap[0];
+		last = heap[--list->count];
+
+		// sift the hole at the root down to where last belongs
+		while ((child = 2 * i + 1) < list->count) {
+			if ((child + 1 < list->count) &&
+			    (list->heap_order * list->comp_func(heap[child + 1],
+								 heap[child]) > 0))
+				child++;
+
+			if (list->heap_order * list->comp_func(heap[child],
+							       last) <= 0)
+				break;
+
+			heap[i] = heap[child];
+			i = child;
+			levels++;
+		}
+		heap[i] = last;
+
+		list_modified(list);
+	}
+
+	unlock(list);
+	op_end(list, LLIST_OP_POP, levels);
+
+	return node;
+}
+
+// Destroy the count nodes of a ring array starting at slot first
+static void ring_destroy_nodes(llist_node *ring, unsigned int capacity,
+			       unsigned int first, unsigned int count,
+			       node_func destructor)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		if (destructor)
+			destructor(ring[first]);
+		else
+			free(ring[first]);
+
+		first = (first + 1 == capacity) ? 0 : first + 1;
+	}
+}
+
+static int ring_clear(_llist *list, bool destroy_nodes, node_func destructor)
+{
+	llist_node *old = NULL;
+	unsigned int count, first, capacity;
+
+	op_begin(list, LLIST_OP_DELETE);
+
+	if (write_lock(list)) {
+		op_end(list, LLIST_OP_DELETE, 0);
+		return LLIST_MULTITHREAD_ISSUE;
+	}
+
+	count = list->count;
+	first = list->ring_first;
+	capacity = list->ring_capacity;
+
+	// swap in an empty array so that the nodes are destroyed unlocked
+	if (destroy_nodes && count) {
+		old = list->ring;
+		list->ring = malloc(capacity * sizeof(llist_node));
+		if (list->ring == NULL) {
+			list->ring = old;
+			old = NULL;
+			ring_destroy_nodes(list->ring, capacity, first, count,
+					   destructor);
+		}
+	}
+
+	list->count = 0;
+	list->ring_first = 0;
+	list_modified(list);
+
+	unlock(list);
+	op_end(list, LLIST_OP_DELETE, count);
+
+	if (old) {
+		ring_destroy_nodes(old, capacity, first, count, destructor);
+		free(old);
+	}
+
+	return LLIST_SUCCESS;
+}
+
+// Release a chain of wrappers that is no longer reachable from any list
+static void free_chain(_list_node *iterator, bool destroy_nodes,
+		       node_func destructor)
+{
+	_list_node *next;
+
+	while (iterator != NULL) {
+
+		if (destroy_nodes) {
+			if (destructor)
+				destructor(iterator->node);
+			else
+				free(iterator->node);
+		}
+
+		next = iterator->next;
+		free_wrapper(iterator);    // Delete's the container
+		iterator = next;
+	}
+}
+
+/*
+ * Queue a chain of wrappers unlinked (under the write lock) from a
+ * FLAG_DEFERRED_RECLAIM list, they get destroyed and freed later by
+ * llist_reclaim() or the reclaimer thread. Consecutive deletions with the
+ * same destructor share a batch. Returns false if the list doesn't defer or
+ * the queue can't grow, the caller then frees the chain itself.
+ */
+static bool defer_chain(_llist *list, _list_node *first, _list_node *last,
+			unsigned int count, bool destroy_nodes,
+			node_func destructor)
+{
+	_reclaim_queue *queue = list->reclaim;
+	_reclaim_batch *batch;
+
+	if (queue == NULL)
+		return false;
+
+	if (!destroy_nodes)
+		destructor = NULL;
+
+	batch = queue->tail;
+	if ((batch == NULL) || (batch->destroy_nodes != destroy_nodes) ||
+	    (batch->destructor != destructor)) {
+		batch = malloc(sizeof(_reclaim_batch));
+		if (batch == NULL)
+			return false;
+
+		batch->destroy_nodes = destroy_nodes;
+		batch->destructor = destructor;
+		batch->first = NULL;
+		batch->next = NULL;
+
+		if (queue->tail)
+			queue->tail->next = batch;
+		else
+			queue->head = batch;
+		queue->tail = batch;
+	}
+
+	last->next = NULL;
+	if (batch->first)
+		batch->last->next = first;
+	else
+		batch->first = first;
+	batch->last = last;
+
+	queue->pending += count;
+	if ((queue->pending >= LLIST_RECLAIM_BATCH) &&
+	    (queue->pending - count < LLIST_RECLAIM_BATCH)) {
+		// the flag keeps the wakeup if the reclaimer isn't waiting yet
+		pthread_mutex_lock(&queue->mutex);
+		queue->wakeup = true;
+		pthread_cond_signal(&queue->cond);
+		pthread_mutex_unlock(&queue->mutex);
+	}
+
+	return true;
+}
+
+// Destroy and free a wrapper just unlinked from list, or queue it
+static void release_node(_llist *list, _list_node *wrapper, bool destroy_node,
+			 node_func destructor)
+{
+	if (defer_chain(list, wrapper, wrapper, 1, destroy_node, destructor))
+		return;
+
+	wrapper->next = NULL;
+	free_chain(wrapper, destroy_node, destructor);
+}
+
+// Take every queued batch, under the write lock
+static _reclaim_batch *reclaim_detach(_llist *list, unsigned int *count)
+{
+	_reclaim_batch *batches = list->reclaim->head;
+
+	*count = list->reclaim->pending;
+	list->reclaim->head = list->reclaim->tail = NULL;
+	list->reclaim->pending = 0;
+
+	return batches;
+}
+
+static void reclaim_run(_reclaim_batch *batch)
+{
+	_reclaim_batch *next;
+
+	for (; batch; batch = next) {
+		next = batch->next;
+		free_chain(batch->first, batch->destroy_nodes,
+			   batch->destructor);
+		free(batch);
+	}
+}
+
+// Release everything queued, count is set to the number of nodes
+static int reclaim_all(llist list, unsigned int *count)
+{
+	_reclaim_batch *batches;
+
+	*count = 0;
+
+	if (write_lock(list))
+		return LLIST_MULTITHREAD_ISSUE;
+
+	batches = reclaim_detach((_llist *) list, count);
+
+	unlock(list);
+
+	// the destructors run without holding the list
+	reclaim_run(batches);
+
+	return LLIST_SUCCESS;
+}
+
+int llist_reclaim(llist list)
+{
+	unsigned int count;
+	int rc;
+
+	if (list == NULL)
+		return LLIST_NULL_ARGUMENT;
+
+	if (((_llist *) list)->reclaim == NULL)
+		return LLIST_SUCCESS;
+
+	op_begin(list, LLIST_OP_OTHER);
+	rc = reclaim_all(list, &count);
+	op_end(list, LLIST_OP_OTHER, count);
+
+	return rc;
+}
+
+static void *reclaimer(void *data)
+{
+	_llist *list = data;
+	_reclaim_queue *queue = list->reclaim;
+	struct timespec deadline;
+
+	pthread_mutex_lock(&queue->mutex);
+
+	while (queue->running) {
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += queue->interval_ms / 1000;
+		deadline.tv_nsec += (queue->interval_ms % 1000) * 1000000L;
+		if (deadline.tv_nsec >= 1000000000L) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
+		}
+
+		if (!queue->wakeup)
+			pthread_cond_timedwait(&queue->cond, &queue->mutex,
+					       &deadline);
+		queue->wakeup = false;
+
+		// llist_reclaimer_stop() takes care of what is left
+		if (!queue->running)
+			break;
+
+		pthread_mutex_unlock(&queue->mutex);
+		llist_reclaim(list);
+		pthread_mutex_lock(&queue->mutex);
+	}
+
+	pthread_mutex_unlock(&queue->mutex);
+
+	return NULL;
+}
+
+int llist_reclaimer_start(llist list, unsigned int interval_ms)
+{
+	_llist *thelist = (_llist *) list;
+	_reclaim_queue *queue;
+	int rc = LLIST_SUCCESS;
+
+	if (list == NULL)
+		return LLIST_NULL_ARGUMENT;
+
+	queue = thelist->reclaim;
+	if ((queue == NULL) || !thelist->ismt || (interval_ms == 0))
+		return LLIST_ERROR;
+
+	op_begin(list, LLIST_OP_OTHER);
+	pthread_mutex_lock(&queue->mutex);
+
+	if (queue->running) {
+		rc = LLIST_ERROR;
+	} else {
+		queue->running = true;
+		queue->interval_ms = interval_ms;
+		if (pthread_create(&queue->thread, NULL, reclaimer, list)) {
+			queue->running = false;
+			rc = LLIST_MULTITHREAD_ISSUE;
+		}
+	}
+
+	pthread_mutex_unlock(&queue->mutex);
+	op_end(list, LLIST_OP_OTHER, 0);
+
+	return rc;
+}
+
+// Stop the reclaimer thread if there is one, without reclaiming
+static void reclaimer_halt(_reclaim_queue *queue)
+{
+	bool running;
+
+	pthread_mutex_lock(&queue->mutex);
+	running = queue->running;
+	queue->running = false;
+	pthread_cond_signal(&queue->cond);
+	pthread_mutex_unlock(&queue->mutex);
+
+	if (running)
+		pthread_join(queue->thread, NULL);
+}
+
+int llist_reclaimer_stop(llist list)
+{
+	unsigned int count;
+	int rc;
+
+	if (list == NULL)
+		return LLIST_NULL_ARGUMENT;
+
+	if (((_llist *) list)->reclaim == NULL)
+		return LLIST_ERROR;
+
+	op_begin(list, LLIST_OP_OTHER);
+	reclaimer_halt(((_llist *) list)->reclaim);
+	rc = reclaim_all(list, &count);
+	op_end(list, LLIST_OP_OTHER, count);
+
+	return rc;
+}
+
+void llist_destroy(llist list, bool destroy_nodes, node_func destructor)
+{
+	unsigned int reclaimed;
+
+	if (list == NULL)
+		return;
+
+	op_begin(list, LLIST_OP_OTHER);
+
+	if (((_llist *) list)->ring) {
+		if (destroy_nodes)
+			ring_destroy_nodes(((_llist *) list)->ring,
+					   ((_llist *) list)->ring_capacity,
+					   ((_llist *) list)->ring_first,
+					   ((_llist *) list)->count, destructor);
+		free(((_llist *) list)->ring);
+	}
+	free_spsc(((_llist *) list)->spsc, destroy_nodes, destructor);
+	free_deque(((_llist *) list)->deque, destroy_nodes, destructor);
+
+	// Finish off what earlier deletions left behind
+	if (((_llist *) list)->reclaim) {
+		reclaimer_halt(((_llist *) list)->reclaim);
+		reclaim_all(list, &reclaimed);
+		free_reclaim(((_llist *) list)->reclaim);
+	}
+
+	// Delete the data contained in the nodes
+	free_chain(((_llist *) list)->head, destroy_nodes, destructor);
+
+	if (true == ((_llist *)list)->ismt) {
+		//release any thread related resource, just try to destroy no use checking return code
+		pthread_rwlockattr_destroy(&((_llist *) list)->llist_lock_attr);
+		pthread_rwlock_destroy(&((_llist *) list)->llist_lock);
+	}
+	free(((_llist *) list)->index);
+	free_positions(((_llist *) list)->positions);
+	free(((_llist *) list)->stats);
+
+	trace_end(list, LLIST_OP_OTHER, ((_llist *) list)->count);
+
+	//release the list
+	free(list);
+}
+
+int llist_clear(llist list, bool destroy_nodes, node_func destructor)
+{
+	_llist *thelist = (_llist *) list;
+	_list_node *head, *tail;
+	unsigned int count;
+
+	if (list == NULL)
+		return LLIST_NULL_ARGUMENT;
+
+	if (in_array(list))
+		return ring_clear(thelist, destroy_nodes, destructor);
+
+	if (lock_free(list))
+		return LLIST_NOT_IMPLEMENTED;
+
+	op_begin(list, LLIST_OP_DELETE);
+
+	if (write_lock(list)) {
+		op_end(list, LLIST_OP_DELETE, 0);
+		return LLIST_MULTITHREAD_ISSUE;
+	}
+
+	head = thelist->head;
+	tail = thelist->tail;
+	count = thelist->count;
+
+	if (head) {
+		thelist->head = thelist->tail = NULL;
+		thelist->count = 0;
+		list_modified(list);
+
+		if (defer_chain(thelist, head, tail, count, destroy_nodes,
+				destructor))
+			head = NULL;
+	}
+
+	unlock(list);
+	op_end(list, LLIST_OP_DELETE, count);
+
+	// the expensive part runs without holding the list
+	free_chain(head, destroy_nodes, destructor);
+
+	return LLIST_SUCCESS;
+}
+
+int llist_size(llist list)
+{
+	unsigned int retval = 0;
+
+	if (list == NULL)
+		return 0;
+
+	if (((_llist *) list)->mode == LLIST_MODE_SPSC)
+		return spsc_size(((_llist *) list)->spsc);
+
+	if (((_llist *) list)->mode == LLIST_MODE_DEQUE)
+		return deque_size(((_llist *) list)->deque);
+
+	op_begin(list, LLIST_OP_READ);
+
+	if (read_lock(list)) {
+		op_end(list, LLIST_OP_READ, 0);
+		return LLIST_MULTITHREAD_ISSUE;
+	}
+
+	//read only critical section
+	retval = ((_llist *) list)->count;
+
+	unlock(list);
+	op_end(list, LLIST_OP_READ, 0);
+
+	return retval;
+}
+
+int llist_add_node(llist list, llist_node node, int flags)
+{
+	_list_node *node_wrapper = NULL;
+
+	if (list == NULL)
+		return LLIST_NULL_ARGUMENT;
+
+	if (((_llist *) list)->mode == LLIST_MODE_RING)
+		return ring_add_node(list, node, flags);
+
+	// both ends are the same to a priority queue
+	if (((_llist *) list)->mode == LLIST_MODE_HEAP)
+		return pq_add_node(list, node);
+
+	if (((_llist *) list)->mode == LLIST_MODE_SPSC)
+		return spsc_add_node(list, node, flags);
+
+	// the rear of a deque belongs to the thieves
+	if (((_llist *) list)->mode == LLIST_MODE_DEQUE)
+		return (flags & ADD_NODE_FRONT) ? deque_push(list, node) :
+		       LLIST_NOT_IMPLEMENTED;
+
+	op_begin(list, LLIST_OP_ADD);
+	//
+	//write critical section
+	node_wrapper = alloc_wrapper(list);
+	if (node_wrapper == NULL) {
+		op_end(list, LLIST_OP_ADD, 0);
+		return LLIST_MALLOC_ERROR;
+	}
+
+	if (write_lock(list)) {
+		free_wrapper(node_wrapper);
+		op_end(list, LLIST_OP_ADD, 0);
+		return LLIST_MULTITHREAD_ISSUE;
+	}
+
+	node_wrapper->node = node;
+	if (((_llist *) list)->positions)
+		position_insert(list, (flags & ADD_NODE_FRONT) ? 0 :
+				((_llist *) list)->count, node_wrapper);
+	((_llist *) list)->count++;
+	list_changed(list);
+
+	if (((_llist *) list)->head == NULL) {      // Adding the first node, update head and tail to point to that node
+		node_wrapper->next = NULL;
+		((_llist *) list)->head =
+			((_llist *) list)->tail = node_wrapper;
+	} else if (flags & ADD_NODE_FRONT) {
+		node_wrapper->next = ((_llist *) list)->head;
+		((_llist *) list)->head = node_wrapper;
+	} else { // add node in the rear
+		node_wrapper->next = NULL;
+		((_llist *) list)->tail->next = node_wrapper;
+		((_llist *) list)->tail = node_wrapper;
+	}
+
+	unlock(list);
+	op_end(list, LLIST_OP_ADD, 0);
+
+	return LLIST_SUCCESS;
+}
+
+int llist_delete_node(llist list, llist_node node,
+		      bool destroy_node, node_func destructor)
+{
+	_list_node *iterator;
+	_list_node *temp;
+	_list_node *ahead;
+	equal actual_equal;
+	unsigned int scanned = 1;
+
+	if ((list == NULL) || (node == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(list))
+		return LLIST_NOT_IMPLEMENTED;
+
+	actual_equal = ((_llist *) list)->equal_func;
+
+	if (actual_equal == NULL)
+		return LLIST_EQUAL_MISSING;
+
+	op_begin(list, LLIST_OP_DELETE);
+
+	if (write_lock(list)) {
+		op_end(list, LLIST_OP_DELETE, 0);
+		return LLIST_MULTITHREAD_ISSUE;
+	}
+
+	iterator = ((_llist *) list)->head;
+
+	if (iterator == NULL) {
+		unlock(list);
+		op_end(list, LLIST_OP_DELETE, 0);
+		return LLIST_NODE_NOT_FOUND;
+	}
+
+	// is it the first node ?
+	if (actual_equal(iterator->node, node)) {
+		((_llist *) list)->head = iterator->next;
+		((_llist *) list)->count--;
+		list_modified(list);
+
+		if (((_llist *) list)->count == 0) {
+			/*
+			 *  if we deleted the last node, we need to reset the tail
+			 *  also, because the last node must be the head (and tail)
+			 */
+			((_llist *) list)->tail = NULL;
+		}
+
+		release_node(list, iterator, destroy_node, destructor);
+		unlock(list);
+		op_end(list, LLIST_OP_DELETE, scanned);
+		return LLIST_SUCCESS;
+	}
+
+	ahead = prefetch_start(iterator->next);
+
+	while (iterator->next != NULL) {
+		ahead = prefetch_step(ahead);
+		scanned++;
+
+		if (actual_equal(iterator->next->node, node)) {
+			// found it
+			temp = iterator->next;
+			iterator->next = temp->next;
+
+			// if we unlinked the tail, the tail is now the predecessor
+			if (temp == ((_llist *) list)->tail)
+				((_llist *) list)->tail = iterator;
+
+			((_llist *) list)->count--;
+			list_modified(list);
+
+			release_node(list, temp, destroy_node, destructor);
+			unlock(list);
+			op_end(list, LLIST_OP_DELETE, scanned);
+			return LLIST_SUCCESS;
+		}
+
+		iterator = iterator->next;
+	}
+
+	unlock(list);
+	op_end(list, LLIST_OP_DELETE, scanned);
+
+	return LLIST_NODE_NOT_FOUND;
+}
+
+/*
+ * Index every wrapper of the list. Position i gets an entry on as many
+ * levels as LLIST_POSITION_FANOUT divides i + 1, which gives a perfectly
+ * balanced skip list. Failing to allocate isn't an error, the positional
+ * calls just walk the list.
+ */
+static void build_positions(_llist *list)
+{
+	_position_index *positions;
+	_position *last[POSITION_LEVELS], *entry, *below;
+	long pos[POSITION_LEVELS];
+	_list_node *iterator;
+	unsigned int i, n;
+	int level;
+
+	positions = malloc(sizeof(_position_index));
+	if (positions == NULL)
+		return;
+
+	for (level = 0; level < POSITION_LEVELS; level++) {
+		positions->heads[level].wrapper = NULL;
+		positions->heads[level].next = NULL;
+		positions->heads[level].down = level ?
+					       &positions->heads[level - 1] :
+					       NULL;
+		last[level] = &positions->heads[level];
+		pos[level] = -1;
+	}
+	positions->seed = (uintptr_t) list | 1;
+
+	for (iterator = list->head, i = 0; iterator;
+	     iterator = iterator->next, i++) {
+		below = NULL;
+
+		for (level = 0, n = i + 1;
+		     (level < POSITION_LEVELS) && (n % LLIST_POSITION_FANOUT) == 0;
+		     level++, n /= LLIST_POSITION_FANOUT) {
+			entry = malloc(sizeof(_position));
+			if (entry == NULL) {
+				free_positions(positions);
+				return;
+			}
+
+			entry->wrapper = iterator;
+			entry->next = NULL;
+			entry->down = below;
+			last[level]->next = entry;
+			last[level]->width = i - pos[level];
+			last[level] = entry;
+			pos[level] = i;
+			below = entry;
+		}
+	}
+
+	for (level = 0; level < POSITION_LEVELS; level++)
+		last[level]->width = list->count - pos[level];
+
+	list->positions = positions;
+}
+
+/*
+ * Find the last entry before index on every level, and its position (-1 for
+ * the heads). Returns the number of entries visited.
+ */
+static unsigned int position_search(_position_index *positions,
+				    unsigned int index, _position **update,
+				    long *pos)
+{
+	_position *entry = &positions->heads[POSITION_LEVELS - 1];
+	unsigned int scanned = 0;
+	long position = -1;
+	int level;
+
+	for (level = POSITION_LEVELS - 1; level >= 0; level--) {
+		while (entry->next && (position + entry->width < index)) {
+			position += entry->width;
+			entry = entry->next;
+			scanned++;
+		}
+
+		update[level] = entry;
+		pos[level] = position;
+		entry = entry->down;
+	}
+
+	return scanned;
+}
+
+// The wrapper at index (< count), through the position index if there's one
+static _list_node *position_seek(_llist *list, unsigned int index,
+				 unsigned int *scanned)
+{
+	_position *update[POSITION_LEVELS];
+	long pos[POSITION_LEVELS];
+	_list_node *iterator = list->head;
+	unsigned int position = 0;
+
+	if (list->positions) {
+		*scanned += position_search(list->positions, index + 1,
+					    update, pos);
+		if (pos[0] >= 0) {
+			iterator = update[0]->wrapper;
+			position = pos[0];
+		}
+	}
+
+	for (; position < index; position++) {
+		iterator = iterator->next;
+		(*scanned)++;
+	}
+
+	return iterator;
+}
+
+static unsigned int position_random(_position_index *positions)
+{
+	unsigned int x = positions->seed;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	positions->seed = x;
+
+	return x;
+}
+
+// Account for wrapper being linked at index, drops the index on failure
+static void position_insert(_llist *list, unsigned int index,
+			    _list_node *wrapper)
+{
+	_position_index *positions = list->positions;
+	_position *update[POSITION_LEVELS], *entry, *below = NULL;
+	long pos[POSITION_LEVELS];
+	int level, height = 0;
+
+	position_search(positions, index, update, pos);
+
+	while ((height < POSITION_LEVELS) &&
+	       (position_random(positions) % LLIST_POSITION_FANOUT) == 0)
+		height++;
+
+	for (level = 0; level < POSITION_LEVELS; level++) {
+		if (level >= height) {
+			update[level]->width++;
+			continue;
+		}
+
+		entry = malloc(sizeof(_position));
+		if (entry == NULL) {
+			drop_positions(list);
+			return;
+		}
+
+		entry->wrapper = wrapper;
+		entry->down = below;
+		entry->next = update[level]->next;
+		entry->width = pos[level] + update[level]->width + 1 - index;
+		update[level]->next = entry;
+		update[level]->width = index - pos[level];
+		below = entry;
+	}
+}
+
+// Account for the wrapper at index being unlinked
+static void position_remove(_llist *list, unsigned int index)
+{
+	_position *update[POSITION_LEVELS], *entry;
+	long pos[POSITION_LEVELS];
+	int level;
+
+	position_search(list->positions, index, update, pos);
+
+	for (level = 0; level < POSITION_LEVELS; level++) {
+		entry = update[level]->next;
+
+		if (entry && (pos[level] + update[level]->width == index)) {
+			update[level]->width += entry->width - 1;
+			update[level]->next = entry->next;
+			free(entry);
+		} else {
+			update[level]->width--;
+		}
+	}
+}
+
+/*
+ * Lock the list for a positional lookup. The position index is built on
+ * first use, which needs the write lock, so that's what is taken (and kept)
+ * when the index is missing.
+ */
+static int positional_read_lock(_llist *list)
+{
+	int rc;
+
+	rc = read_lock(list);
+	if (rc || !list->positional || list->positions)
+		return rc;
+
+	unlock(list);
+	rc = write_lock(list);
+	if ((rc == 0) && (list->positions == NULL))
+		build_positions(list);
+
+	return rc;
+}
+
+int llist_get_at(llist list, unsigned int index, llist_node *node)
+{
+	_llist *thelist = (_llist *) list;
+	unsigned int scanned = 0;
+
+	if ((list == NULL) || (node == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (lock_free(list) || (thelist->mode == LLIST_MODE_HEAP))
+		return LLIST_NOT_IMPLEMENTED;
+
+	op_begin(list, LLIST_OP_READ);
+
+	if (positional_read_lock(thelist)) {
+		op_end(list, LLIST_OP_READ, 0);
+		return LLIST_MULTITHREAD_ISSUE;
+	}
+
+	if (index >= thelist->count) {
+		unlock(list);
+		op_end(list, LLIST_OP_READ, 0);
+		return LLIST_NODE_NOT_FOUND;
+	}
+
+	if (thelist->mode == LLIST_MODE_RING)
+		*node = *ring_slot(thelist, index);
+	else
+		*node = position_seek(thelist, index, &scanned)->node;
+
+	unlock(list);
+	op_end(list, LLIST_OP_READ, scanned);
+
+	return LLIST_SUCCESS;
+}
+
+int llist_insert_at(llist list, unsigned int index, llist_node node)
+{
+	_llist *thelist = (_llist *) list;
+	_list_node *node_wrapper, *prev;
+	unsigned int scanned = 0;
+
+	if (list == NULL)
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(list))
+		return LLIST_NOT_IMPLEMENTED;
+
+	op_begin(list, LLIST_OP_INSERT);
+
+	node_wrapper = alloc_wrapper(list);
+	if (node_wrapper == NULL) {
+		op_end(list, LLIST_OP_INSERT, 0);
+		return LLIST_MALLOC_ERROR;
+	}
+
+	if (write_lock(list)) {
+		free_wrapper(node_wrapper);
+		op_end(list, LLIST_OP_INSERT, 0);
+		return LLIST_MULTITHREAD_ISSUE;
+	}
+
+	if (index > thelist->count) {
+		unlock(list);
+		free_wrapper(node_wrapper);
+		op_end(list, LLIST_OP_INSERT, 0);
+		return LLIST_NODE_NOT_FOUND;
+	}
+
+	if (thelist->positional && (thelist->positions == NULL))
+		build_positions(thelist);
+
+	node_wrapper->node = node;
+	if (index == 0) {
+		node_wrapper->next = thelist->head;
+		thelist->head = node_wrapper;
+		if (thelist->tail == NULL)
+			thelist->tail = node_wrapper;
+	} else {
+		prev = position_seek(thelist, index - 1, &scanned);
+		node_wrapper->next = prev->next;
+		prev->next = node_wrapper;
+		if (prev == thelist->tail)
+			thelist->tail = node_wrapper;
+	}
+
+	if (thelist->positions)
+		position_insert(thelist, index, node_wrapper);
+	thelist->count++;
+	list_changed(list);
+
+	unlock(list);
+	op_end(list, LLIST_OP_INSERT, scanned);
+
+	return LLIST_SUCCESS;
+}
+
+int llist_delete_at(llist list, unsigned int index, bool destroy_node,
+		    node_func destructor)
+{
+	_llist *thelist = (_llist *) list;
+	_list_node *temp, *prev;
+	unsigned int scanned = 0;
+
+	if (list == NULL)
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(list))
+		return LLIST_NOT_IMPLEMENTED;
+
+	op_begin(list, LLIST_OP_DELETE);
+
+	if (write_lock(list)) {
+		op_end(list, LLIST_OP_DELETE, 0);
+		return LLIST_MULTITHREAD_ISSUE;
+	}
+
+	if (index >= thelist->count) {
+		unlock(list);
+		op_end(list, LLIST_OP_DELETE, 0);
+		return LLIST_NODE_NOT_FOUND;
+	}
+
+	if (thelist->positional && (thelist->positions == NULL))
+		build_positions(thelist);
+
+	if (index == 0) {
+		temp = thelist->head;
+		thelist->head = temp->next;
+		if (thelist->head == NULL)
+			thelist->tail = NULL;
+	} else {
+		prev = position_seek(thelist, index - 1, &scanned);
+		temp = prev->next;
+		prev->next = temp->next;
+		if (temp == thelist->tail)
+			thelist->tail = prev;
+	}
+
+	if (thelist->positions)
+		position_remove(thelist, index);
+	thelist->count--;
+	list_changed(list);
+
+	release_node(list, temp, destroy_node, destructor);
+	unlock(list);
+	op_end(list, LLIST_OP_DELETE, scanned + 1);
+
+	return LLIST_SUCCESS;
+}
+
+int llist_for_each(llist list, node_func func)
+{
+	_list_node *iterator, *ahead;
+	unsigned int count, i;
+
+	if ((list == NULL) || (func == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (lock_free(list))
+		return LLIST_NOT_IMPLEMENTED;
+
+	op_begin(list, LLIST_OP_TRAVERSE);
+	read_lock(list);
+
+	iterator = ((_llist *) list)->head;
+	ahead = prefetch_start(iterator);
+	count = ((_llist *) list)->count;
+
+	// arrays have no chain (head is NULL), they are read in order
+	if (in_array(list)) {
+		for (i = 0; i < count; i++)
+			func(*ring_slot(list, i));
+	}
+
+	while (iterator != NULL) {
+		ahead = prefetch_step(ahead);
+		func(iterator->node);
+		iterator = iterator->next;
+	}
+
+	unlock(list);
+	op_end(list, LLIST_OP_TRAVERSE, count);
+
+	return LLIST_SUCCESS;
+}
+
+int llist_for_each_arg(llist list, node_func_arg func, void *arg)
+{
+	_list_node *iterator, *ahead;
+	unsigned int count, i;
+
+	if ((list == NULL) || (func == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (lock_free(list))
+		return LLIST_NOT_IMPLEMENTED;
+
+	op_begin(list, LLIST_OP_TRAVERSE);
+	read_lock(list);
+
+	iterator = ((_llist *) list)->head;
+	ahead = prefetch_start(iterator);
+	count = ((_llist *) list)->count;
+
+	// arrays have no chain (head is NULL), they are read in order
+	if (in_array(list)) {
+		for (i = 0; i < count; i++)
+			func(*ring_slot(list, i), arg);
+	}
+
+	while (iterator != NULL) {
+		ahead = prefetch_step(ahead);
+		func(iterator->node, arg);
+		iterator = iterator->next;
+	}
+
+	unlock(list);
+	op_end(list, LLIST_OP_TRAVERSE, count);
+
+	return LLIST_SUCCESS;
+}
+
+/*
+ * A contiguous part of the chain handled by one thread of
+ * llist_parallel_for_each() / llist_parallel_map_reduce()
+ */
+typedef struct {
+	_list_node *start;
+	unsigned int length;
+	node_func_arg func;
+	node_map map;
+	node_combine combine;
+	void *arg;
+	void *result;
+	pthread_t thread;
+	bool spawned;
+} _segment;
+
+static void *segment_worker(void *data)
+{
+	_segment *segment = data;
+	_list_node *iterator = segment->start;
+	unsigned int i;
+
+	if (segment->func) {
+		for (i = 0; i < segment->length; i++) {
+			segment->func(iterator->node, segment->arg);
+			iterator = iterator->next;
+		}
+		return NULL;
+	}
+
+	segment->result = segment->map(iterator->node, segment->arg);
+	iterator = iterator->next;
+
+	for (i = 1; i < segment->length; i++) {
+		segment->result = segment->combine(segment->result,
+						   segment->map(iterator->node,
+								segment->arg),
+						   segment->arg);
+		iterator = iterator->next;
+	}
+
+	return NULL;
+}
+
+/*
+ * Split the list in balanced segments and run them, the first one in the
+ * calling thread. If a thread can't be created its segment runs in the
+ * calling thread as well. The caller holds the read lock.
+ */
+static int run_segments(_llist *list, _segment *templ, unsigned int nthreads,
+			_segment **out, unsigned int *nsegments)
+{
+	_segment *segments;
+	_list_node *iterator;
+	unsigned int i, j, length;
+
+	if (nthreads == 0) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		nthreads = (cpus > 0) ? cpus : 1;
+	}
+
+	if (nthreads > list->count)
+		nthreads = list->count;
+
+	*out = NULL;
+	*nsegments = nthreads;
+	if (nthreads == 0)
+		return LLIST_SUCCESS;
+
+	segments = malloc(nthreads * sizeof(_segment));
+	if (segments == NULL)
+		return LLIST_MALLOC_ERROR;
+
+	iterator = list->head;
+	for (i = 0; i < nthreads; i++) {
+		length = list->count / nthreads + (i < list->count % nthreads);
+
+		segments[i] = *templ;
+		segments[i].start = iterator;
+		segments[i].length = length;
+		segments[i].result = NULL;
+		segments[i].spawned = false;
+
+		for (j = 0; j < length; j++)
+			iterator = iterator->next;
+	}
+
+	for (i = 1; i < nthreads; i++)
+		segments[i].spawned = !pthread_create(&segments[i].thread, NULL,
+						      segment_worker,
+						      &segments[i]);
+
+	segment_worker(&segments[0]);
+
+	for (i = 1; i < nthreads; i++) {
+		if (segments[i].spawned)
+			pthread_join(segments[i].thread, NULL);
+		else
+			segment_worker(&segments[i]);
+	}
+
+	*out = segments;
+
+	return LLIST_SUCCESS;
+}
+
+int llist_parallel_for_each(llist list, node_func_arg func, void *arg,
+			    unsigned int nthreads)
+{
+	_segment templ = { .func = func, .arg = arg };
+	_segment *segments;
+	unsigned int nsegments, count;
+	int rc;
+
+	if ((list == NULL) || (func == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(list))
+		return LLIST_NOT_IMPLEMENTED;
+
+	op_begin(list, LLIST_OP_TRAVERSE);
+	read_lock(list);
+	count = ((_llist *) list)->count;
+	rc = run_segments((_llist *) list, &templ, nthreads, &segments,
+			  &nsegments);
+	unlock(list);
+	op_end(list, LLIST_OP_TRAVERSE, count);
+
+	free(segments);
+
+	return rc;
+}
+
+int llist_parallel_map_reduce(llist list, node_map map, node_combine combine,
+			      void *arg, unsigned int nthreads, void **result)
+{
+	_segment templ = { .map = map, .combine = combine, .arg = arg };
+	_segment *segments;
+	unsigned int nsegments, i, count;
+	int rc;
+
+	if ((list == NULL) || (map == NULL) || (combine == NULL) ||
+	    (result == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(list))
+		return LLIST_NOT_IMPLEMENTED;
+
+	op_begin(list, LLIST_OP_TRAVERSE);
+	read_lock(list);
+	count = ((_llist *) list)->count;
+	rc = run_segments((_llist *) list, &templ, nthreads, &segments,
+			  &nsegments);
+	unlock(list);
+	op_end(list, LLIST_OP_TRAVERSE, count);
+
+	if (rc != LLIST_SUCCESS)
+		return rc;
+
+	*result = NULL;
+	if (nsegments > 0) {
+		*result = segments[0].result;
+		for (i = 1; i < nsegments; i++)
+			*result = combine(*result, segments[i].result, arg);
+	}
+
+	free(segments);
+
+	return LLIST_SUCCESS;
+}
+
+int llist_for_each_until(llist list, node_predicate func, void *arg)
+{
+	_list_node *iterator, *ahead;
+	unsigned int scanned = 0;
+
+	if ((list == NULL) || (func == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(list))
+		return LLIST_NOT_IMPLEMENTED;
+
+	op_begin(list, LLIST_OP_TRAVERSE);
+	read_lock(list);
+
+	iterator = ((_llist *) list)->head;
+	ahead = prefetch_start(iterator);
+
+	while (iterator != NULL) {
+		ahead = prefetch_step(ahead);
+		scanned++;
+
+		if (func(iterator->node, arg)) {
+			unlock(list);
+			op_end(list, LLIST_OP_TRAVERSE, scanned);
+			return LLIST_SUCCESS;
+		}
+		iterator = iterator->next;
+	}
+
+	unlock(list);
+	op_end(list, LLIST_OP_TRAVERSE, scanned);
+
+	return LLIST_NODE_NOT_FOUND;
+}
+
+int llist_remove_if(llist list, node_predicate pred, void *arg,
+		    bool destroy_nodes, node_func destructor)
+{
+	_list_node **link, *iterator, *prev = NULL;
+	_list_node *removed = NULL, **removed_link = &removed, *last = NULL;
+	_llist *thelist = (_llist *) list;
+	unsigned int count;
+
+	if ((list == NULL) || (pred == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(list))
+		return LLIST_NOT_IMPLEMENTED;
+
+	op_begin(list, LLIST_OP_DELETE);
+
+	if (write_lock(list)) {
+		op_end(list, LLIST_OP_DELETE, 0);
+		return LLIST_MULTITHREAD_ISSUE;
+	}
+
+	count = thelist->count;
+	link = &thelist->head;
+	while ((iterator = *link) != NULL) {
+		if (pred(iterator->node, arg)) {
+			// unlink it and move it to the removed chain
+			*link = iterator->next;
+			*removed_link = last = iterator;
+			removed_link = &iterator->next;
+			thelist->count--;
+		} else {
+			prev = iterator;
+			link = &iterator->next;
+		}
+	}
+
+	*removed_link = NULL;
+
+	if (removed) {
+		thelist->tail = prev;
+		list_modified(list);
+
+		if (defer_chain(thelist, removed, last, count - thelist->count,
+				destroy_nodes, destructor))
+			removed = NULL;
+	}
+
+	unlock(list);
+	op_end(list, LLIST_OP_DELETE, count);
+
+	// the expensive part runs without holding the list
+	free_chain(removed, destroy_nodes, destructor);
+
+	return LLIST_SUCCESS;
+}
+
+typedef struct {
+	unsigned long hash;
+	_list_node *wrapper;    // NULL while the slot is free
+} _hash_slot;
+
+// Spread a user hash over the low bits, the table is indexed with a mask
+static inline unsigned long hash_mix(unsigned long hash)
+{
+	unsigned long long mixed = hash;
+
+	mixed ^= mixed >> 33;
+	mixed *= 0xff51afd7ed558ccdULL;
+	mixed ^= mixed >> 33;
+
+	return mixed;
+}
+
+// Open addressing table with room for count entries at half load at most
+static _hash_slot *alloc_hash_set(unsigned int count, unsigned long *mask)
+{
+	unsigned long size = 16;
+
+	while (size < 2UL * count)
+		size <<= 1;
+
+	*mask = size - 1;
+
+	return calloc(size, sizeof(_hash_slot));
+}
+
+// The slot holding a node equal to node, or the free slot it would go in
+static _hash_slot *hash_set_slot(_hash_slot *table, unsigned long mask,
+				 equal equal_func, unsigned long hash,
+				 llist_node node)
+{
+	unsigned long i;
+
+	for (i = hash_mix(hash) & mask; table[i].wrapper; i = (i + 1) & mask)
+		if ((table[i].hash == hash) &&
+		    equal_func(table[i].wrapper->node, node))
+			break;
+
+	return &table[i];
+}
+
+/*
+ * Look for a node equal to wrapper's in the set and add wrapper if there is
+ * none. Returns true if an equal node was already there.
+ */
+static bool hash_set_insert(_hash_slot *table, unsigned long mask,
+			    equal equal_func, unsigned long hash,
+			    _list_node *wrapper)
+{
+	_hash_slot *slot = hash_set_slot(table, mask, equal_func, hash,
+					 wrapper->node);
+
+	if (slot->wrapper)
+		return true;
+
+	slot->hash = hash;
+	slot->wrapper = wrapper;
+
+	return false;
+}
+
+// Nodes were unlinked from list, the remaining ones kept their order
+static void list_shrunk(_llist *list)
+{
+	int sorted = list->sorted;
+
+	list_modified(list);
+	if (sorted) {
+		list->sorted = sorted;
+		build_sorted_index(list);
+	}
+}
+
+/*
+ * Unlink every node equal to one kept before it, with the hash set when
+ * there is one, or against the previous kept node otherwise. Returns the
+ * chain of removed wrappers, NULL if none were removed.
+ */
+static _list_node *unlink_duplicates(_llist *list, _hash_slot *table,
+				     unsigned long mask, node_hash hash_func,
+				     _list_node **last)
+{
+	_list_node **link, *iterator, *prev = NULL;
+	_list_node *removed = NULL, **removed_link = &removed;
+	bool duplicate;
+
+	link = &list->head;
+	while ((iterator = *link) != NULL) {
+		if (table)
+			duplicate = hash_set_insert(table, mask,
+						    list->equal_func,
+						    hash_func(iterator->node),
+						    iterator);
+		else
+			duplicate = prev &&
+				    list->equal_func(prev->node,
+						     iterator->node);
+
+		if (duplicate) {
+			*link = iterator->next;
+			*removed_link = *last = iterator;
+			removed_link = &iterator->next;
+			list->count--;
+		} else {
+			prev = iterator;
+			link = &iterator->next;
+		}
+	}
+
+	*removed_link = NULL;
+
+	if (removed) {
+		list->tail = prev;
+		list_shrunk(list);
+	}
+
+	return removed;
+}
+
+static int unique(llist list, node_hash hash_func, bool destroy_nodes,
+		  node_func destructor)
+{
+	_list_node *removed, *last = NULL;
+	_llist *thelist = (_llist *) list;
+	_hash_slot *table = NULL;
+	unsigned long mask = 0;
+	unsigned int count;
+
+	op_begin(list, LLIST_OP_DELETE);
+
+	if (write_lock(list)) {
+		op_end(list, LLIST_OP_DELETE, 0);
+		return LLIST_MULTITHREAD_ISSUE;
+	}
+
+	count = thelist->count;
+
+	if (hash_func) {
+		table = alloc_hash_set(count, &mask);
+		if (table == NULL) {
+			unlock(list);
+			op_end(list, LLIST_OP_DELETE, 0);
+			return LLIST_MALLOC_ERROR;
+		}
+	}
+
+	removed = unlink_duplicates(thelist, table, mask, hash_func, &last);
+
+	if (removed && defer_chain(thelist, removed, last,
+				   count - thelist->count, destroy_nodes,
+				   destructor))
+		removed = NULL;
+
+	unlock(list);
+	op_end(list, LLIST_OP_DELETE, count);
+
+	free(table);
+	free_chain(removed, destroy_nodes, destructor);
+
+	return LLIST_SUCCESS;
+}
+
+int llist_unique(llist list, node_hash hash_func, bool destroy_nodes,
+		 node_func destructor)
+{
+	if ((list == NULL) || (hash_func == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(list))
+		return LLIST_NOT_IMPLEMENTED;
+
+	if (((_llist *) list)->equal_func == NULL)
+		return LLIST_EQUAL_MISSING;
+
+	return unique(list, hash_func, destroy_nodes, destructor);
+}
+
+int llist_unique_sorted(llist list, bool destroy_nodes, node_func destructor)
+{
+	if (list == NULL)
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(list))
+		return LLIST_NOT_IMPLEMENTED;
+
+	if (((_llist *) list)->equal_func == NULL)
+		return LLIST_EQUAL_MISSING;
+
+	return unique(list, NULL, destroy_nodes, destructor);
+}
+
+int llist_iter_begin(llist list, llist_iter *iter, int flags)
+{
+	int rc;
+
+	if ((list == NULL) || (iter == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(list))
+		return LLIST_NOT_IMPLEMENTED;
+
+	op_begin(list, LLIST_OP_TRAVERSE);
+
+	if (flags & ITER_READ_ONLY)
+		rc = read_lock(list);
+	else
+		rc = write_lock(list);
+
+	op_end(list, LLIST_OP_TRAVERSE, 0);
+
+	if (rc)
+		return LLIST_MULTITHREAD_ISSUE;
+
+	iter->list = list;
+	iter->prev = NULL;
+	iter->cur = NULL;
+	iter->flags = flags;
+
+	return LLIST_SUCCESS;
+}
+
+int llist_iter_next(llist_iter *iter, llist_node *node)
+{
+	_list_node *next;
+
+	if ((iter == NULL) || (node == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	op_begin(iter->list, LLIST_OP_TRAVERSE);
+
+	if (iter->cur) {
+		iter->prev = iter->cur;
+		next = ((_list_node *) iter->cur)->next;
+	} else if (iter->prev) {        // right after a removal
+		next = ((_list_node *) iter->prev)->next;
+	} else {                        // not started yet
+		next = ((_llist *) iter->list)->head;
+	}
+
+	iter->cur = next;
+	if (next == NULL) {
+		trace_end(iter->list, LLIST_OP_TRAVERSE, 0);
+		return LLIST_NODE_NOT_FOUND;
+	}
+
+	*node = next->node;
+
+	if (((_llist *) iter->list)->stats)
+		stats_add(&stats_shard(iter->list)->scanned[LLIST_OP_TRAVERSE],
+			  1);
+
+	trace_end(iter->list, LLIST_OP_TRAVERSE, 1);
+
+	return LLIST_SUCCESS;
+}
+
+int llist_iter_remove(llist_iter *iter, bool destroy_node,
+		      node_func destructor)
+{
+	_llist *thelist;
+	_list_node *prev, *cur;
+
+	if (iter == NULL)
+		return LLIST_NULL_ARGUMENT;
+
+	if (iter->flags & ITER_READ_ONLY)
+		return LLIST_ERROR;
+
+	if (iter->cur == NULL)
+		return LLIST_NODE_NOT_FOUND;
+
+	thelist = (_llist *) iter->list;
+	prev = iter->prev;
+	cur = iter->cur;
+	op_begin(thelist, LLIST_OP_DELETE);
+
+	if (prev)
+		prev->next = cur->next;
+	else
+		thelist->head = cur->next;
+
+	if (thelist->tail == cur)
+		thelist->tail = prev;
+
+	thelist->count--;
+	list_modified(thelist);
+
+	release_node(thelist, cur, destroy_node, destructor);
+	iter->cur = NULL;
+	op_end(thelist, LLIST_OP_DELETE, 1);
+
+	return LLIST_SUCCESS;
+}
+
+int llist_iter_insert_before(llist_iter *iter, llist_node node)
+{
+	_llist *thelist;
+	_list_node *node_wrapper, *prev;
+
+	if (iter == NULL)
+		return LLIST_NULL_ARGUMENT;
+
+	if (iter->flags & ITER_READ_ONLY)
+		return LLIST_ERROR;
+
+	thelist = (_llist *) iter->list;
+	op_begin(thelist, LLIST_OP_INSERT);
+
+	node_wrapper = alloc_wrapper(thelist);
+	if (node_wrapper == NULL) {
+		op_end(thelist, LLIST_OP_INSERT, 0);
+		return LLIST_MALLOC_ERROR;
+	}
+
+	prev = iter->prev;
+
+	node_wrapper->node = node;
+	node_wrapper->next = prev ? prev->next : thelist->head;
+
+	if (prev)
+		prev->next = node_wrapper;
+	else
+		thelist->head = node_wrapper;
+
+	if (node_wrapper->next == NULL)
+		thelist->tail = node_wrapper;
+
+	// the new node is behind the cursor now
+	iter->prev = node_wrapper;
+
+	thelist->count++;
+	list_modified(thelist);
+	op_end(thelist, LLIST_OP_INSERT, 0);
+
+	return LLIST_SUCCESS;
+}
+
+int llist_iter_insert_after(llist_iter *iter, llist_node node)
+{
+	_llist *thelist;
+	_list_node *node_wrapper, *pos;
+
+	if (iter == NULL)
+		return LLIST_NULL_ARGUMENT;
+
+	if (iter->flags & ITER_READ_ONLY)
+		return LLIST_ERROR;
+
+	thelist = (_llist *) iter->list;
+	op_begin(thelist, LLIST_OP_INSERT);
+
+	node_wrapper = alloc_wrapper(thelist);
+	if (node_wrapper == NULL) {
+		op_end(thelist, LLIST_OP_INSERT, 0);
+		return LLIST_MALLOC_ERROR;
+	}
+
+	// without a node under the cursor, link where llist_iter_next() looks
+	pos = iter->cur ? iter->cur : iter->prev;
+
+	node_wrapper->node = node;
+	node_wrapper->next = pos ? pos->next : thelist->head;
+
+	if (pos)
+		pos->next = node_wrapper;
+	else
+		thelist->head = node_wrapper;
+
+	if (node_wrapper->next == NULL)
+		thelist->tail = node_wrapper;
+
+	thelist->count++;
+	list_modified(thelist);
+	op_end(thelist, LLIST_OP_INSERT, 0);
+
+	return LLIST_SUCCESS;
+}
+
+void llist_iter_end(llist_iter *iter)
+{
+	if ((iter == NULL) || (iter->list == NULL))
+		return;
+
+	op_begin(iter->list, LLIST_OP_OTHER);
+	unlock(iter->list);
+	trace_end(iter->list, LLIST_OP_OTHER, 0);
+	iter->list = NULL;
+}
+
+int llist_insert_node(llist list, llist_node new_node, llist_node pos_node,
+		      int flags)
+{
+	_list_node *iterator;
+	_list_node *node_wrapper = NULL;
+	unsigned int scanned = 1;
+
+	if ((list == NULL) || (new_node == NULL) || (pos_node == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(list))
+		return LLIST_NOT_IMPLEMENTED;
+
+	op_begin(list, LLIST_OP_INSERT);
+
+	node_wrapper = alloc_wrapper(list);
+	if (node_wrapper == NULL) {
+		op_end(list, LLIST_OP_INSERT, 0);
+		return LLIST_MALLOC_ERROR;
+	}
+
+	node_wrapper->node = new_node;
+
+	write_lock(list);
+
+	iterator = ((_llist *) list)->head;
+
+	if (iterator == NULL) {
+		// empty list, pos_node cannot exist in it
+		unlock(list);
+		op_end(list, LLIST_OP_INSERT, 0);
+		free_wrapper(node_wrapper);
+		return LLIST_NODE_NOT_FOUND;
+	}
+
+	if (iterator->node == pos_node) {
+		// it's the first node
+
+		if (flags & ADD_NODE_BEFORE) {
+			node_wrapper->next = iterator;
+			((_llist *) list)->head = node_wrapper;
+		} else {
+			node_wrapper->next = iterator->next;
+			iterator->next = node_wrapper;
+			// inserting after the only node makes a new tail
+			if (node_wrapper->next == NULL)
+				((_llist *) list)->tail = node_wrapper;
+		}
+		((_llist *) list)->count++;
+		list_modified(list);
+		unlock(list);
+		op_end(list, LLIST_OP_INSERT, scanned);
+
+		return LLIST_SUCCESS;
+	}
+
+	while (iterator->next != NULL) {
+		scanned++;
+		if (iterator->next->node == pos_node) {
+			if (flags & ADD_NODE_BEFORE) {
+				node_wrapper->next = iterator->next;
+				iterator->next = node_wrapper;
+			} else {
+				iterator = iterator->next;
+				// now we stand on the pos node
+				node_wrapper->next = iterator->next;
+				iterator->next = node_wrapper;
+				// inserting after the tail makes a new tail
+				if (node_wrapper->next == NULL)
+					((_llist *) list)->tail = node_wrapper;
+			}
+			((_llist *) list)->count++;
+			list_modified(list);
+			unlock(list);
+			op_end(list, LLIST_OP_INSERT, scanned);
+			return LLIST_SUCCESS;
+		}
+
+		iterator = iterator->next;
+	}
+
+	// pos_node was not found in the list
+	unlock(list);
+	op_end(list, LLIST_OP_INSERT, scanned);
+	free_wrapper(node_wrapper);
+	return LLIST_NODE_NOT_FOUND;
+}
+
+int llist_find_node(llist list, void *data, llist_node *found)
+{
+	_list_node *iterator, *ahead;
+	equal actual_equal;
+	unsigned int scanned = 0;
+
+	if (list == NULL)
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(list))
+		return LLIST_NOT_IMPLEMENTED;
+
+	actual_equal = ((_llist *) list)->equal_func;
+
+	if (actual_equal == NULL) {
+		return LLIST_EQUAL_MISSING;
+	}
+
+	op_begin(list, LLIST_OP_FIND);
+	read_lock(list);
+
+	iterator = ((_llist *) list)->head;
+	ahead = prefetch_start(iterator);
+	while (iterator != NULL) {
+		ahead = prefetch_step(ahead);
+		scanned++;
+
+		if (actual_equal(iterator->node, data)) {
+			*found = iterator->node;
+			unlock(list);
+			op_end(list, LLIST_OP_FIND, scanned);
+			return LLIST_SUCCESS;
+		}
+		iterator = iterator->next;
+	}
+
+	unlock(list);
+	op_end(list, LLIST_OP_FIND, scanned);
+
+	// Didn't find the node
+	return LLIST_NODE_NOT_FOUND;
+}
+
+llist_node llist_get_head(llist list)
+{
+	llist_node node = NULL;
+
+	if (list == NULL)
+		return NULL;
+
+	if (((_llist *) list)->mode == LLIST_MODE_SPSC)
+		return spsc_take(list, false);
+
+	op_begin(list, LLIST_OP_READ);
+	read_lock(list);
+
+	if (((_llist *) list)->count == 0)
+		node = NULL;
+	else if (in_array(list))
+		node = *ring_slot(list, 0);
+	else
+		node = ((_llist *) list)->head->node;
+
+	unlock(list);
+	op_end(list, LLIST_OP_READ, 0);
+
+	return node;
+}
+
+llist_node llist_get_tail(llist list)
+{
+	llist_node node = NULL;
+
+	if (list == NULL)
+		return NULL;
+
+	if (((_llist *) list)->mode == LLIST_MODE_SPSC)
+		return spsc_get_tail(list);
+
+	op_begin(list, LLIST_OP_READ);
+	read_lock(list);
+
+	// a heap has no meaningful tail
+	if ((((_llist *) list)->count == 0) ||
+	    (((_llist *) list)->mode == LLIST_MODE_HEAP))
+		node = NULL;
+	else if (((_llist *) list)->mode == LLIST_MODE_RING)
+		node = *ring_slot(list, ((_llist *) list)->count - 1);
+	else
+		node = ((_llist *) list)->tail->node;
+
+	unlock(list);
+	op_end(list, LLIST_OP_READ, 0);
+
+	return node;
+}
+
+int llist_push(llist list, llist_node node)
+{
+	return llist_add_node(list, node, ADD_NODE_FRONT);
+}
+
+llist_node llist_peek(llist list)
+{
+	return llist_get_head(list);
+}
+
+llist_node llist_pop(llist list)
+{
+	llist_node tempnode = NULL;
 	_list_node *tempwrapper;
 
 	if (list == NULL)
 		return NULL;
 
-	write_lock(list);
+	if (((_llist *) list)->mode == LLIST_MODE_RING)
+		return ring_pop(list);
+
+	if (((_llist *) list)->mode == LLIST_MODE_HEAP)
+		return pq_pop(list);
+
+	if (((_llist *) list)->mode == LLIST_MODE_SPSC)
+		return spsc_take(list, true);
+
+	if (((_llist *) list)->mode == LLIST_MODE_DEQUE)
+		return deque_pop(list);
+
+	op_begin(list, LLIST_OP_POP);
+	write_lock(list);
+
+	if (((_llist *) list)->count) {      // There exists at least one node
+		tempwrapper = ((_llist *) list)->head;
+		tempnode = tempwrapper->node;
+		((_llist *) list)->head = ((_llist *) list)->head->next;
+		if (((_llist *) list)->positions)
+			position_remove(list, 0);
+		((_llist *) list)->count--;
+		list_changed(list);
+		release_node(list, tempwrapper, false, NULL);
+
+		if (((_llist *) list)->count == 0)      // We've deleted the last node
+			((_llist *) list)->tail = NULL;
+	}
+
+	unlock(list);
+	op_end(list, LLIST_OP_POP, 0);
+
+	return tempnode;
+}
+
+int llist_concat(llist first, llist second)
+{
+	_list_node *end_node;
+
+	if ((first == NULL) || (second == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(first) || !chained(second))
+		return LLIST_NOT_IMPLEMENTED;
+
+	op_begin(first, LLIST_OP_RESTRUCTURE);
+	write_lock_two(first, second);
+
+	end_node = ((_llist *) first)->tail;
+
+	((_llist *) first)->count += ((_llist *) second)->count;
+
+	if (((_llist *) second)->head != NULL) {  // nothing to do for an empty second
+		if (end_node != NULL)  // first is not empty, link the chains
+			end_node->next = ((_llist *) second)->head;
+		else                   // first is empty, adopt second's head
+			((_llist *) first)->head = ((_llist *) second)->head;
+
+		// the concatenated list ends where the second list ended
+		((_llist *) first)->tail = ((_llist *) second)->tail;
+	}
+
+	// Delete the nodes from the second list. (not really deletes them, only loses their reference.
+	((_llist *) second)->count = 0;
+	((_llist *) second)->head = ((_llist *) second)->tail = NULL;
+
+	list_modified(first);
+	list_modified(second);
+
+	unlock_two(first, second);
+	op_end(first, LLIST_OP_RESTRUCTURE, 0);
+
+	return LLIST_SUCCESS;
+}
+
+// Append the chain first..last of count wrappers, under the write lock
+static void append_chain(_llist *list, _list_node *first, _list_node *last,
+			 unsigned int count)
+{
+	last->next = NULL;
+
+	if (list->tail)
+		list->tail->next = first;
+	else
+		list->head = first;
+
+	list->tail = last;
+	list->count += count;
+	list_modified(list);
+}
+
+int llist_split_at(llist list, unsigned int index, llist out)
+{
+	_list_node *prev = NULL, *first;
+	unsigned int i, moved;
+
+	if ((list == NULL) || (out == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(list) || !chained(out))
+		return LLIST_NOT_IMPLEMENTED;
+
+	if (list == out)
+		return LLIST_ERROR;
+
+	_llist *thelist = (_llist *) list;
+
+	op_begin(list, LLIST_OP_RESTRUCTURE);
+	write_lock_two(list, out);
+
+	if (index > thelist->count) {
+		unlock_two(list, out);
+		op_end(list, LLIST_OP_RESTRUCTURE, 0);
+		return LLIST_NODE_NOT_FOUND;
+	}
+
+	moved = thelist->count - index;
+	if (moved > 0) {
+		first = thelist->head;
+		for (i = 0; i < index; i++) {
+			prev = first;
+			first = first->next;
+		}
+
+		append_chain(out, first, thelist->tail, moved);
+
+		if (prev)
+			prev->next = NULL;
+		else
+			thelist->head = NULL;
+
+		thelist->tail = prev;
+		thelist->count = index;
+		list_modified(list);
+	}
+
+	unlock_two(list, out);
+	op_end(list, LLIST_OP_RESTRUCTURE, index);
+
+	return LLIST_SUCCESS;
+}
+
+int llist_splice(llist dest, llist_node pos, llist src, llist_node from,
+		 llist_node to)
+{
+	_llist *d = (_llist *) dest;
+	_llist *s = (_llist *) src;
+	_list_node *first, *last, *before = NULL, *after = NULL;
+	unsigned int index = 0, moved = 1;
+
+	if ((dest == NULL) || (src == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(dest) || !chained(src))
+		return LLIST_NOT_IMPLEMENTED;
+
+	if (dest == src)
+		return LLIST_ERROR;
+
+	op_begin(dest, LLIST_OP_RESTRUCTURE);
+	write_lock_two(dest, src);
+
+	// look everything up before relinking anything
+	first = s->head;
+	if (from) {
+		while (first && (first->node != from)) {
+			before = first;
+			first = first->next;
+			index++;
+		}
+	}
+
+	last = first;
+	if (first && (to == NULL)) {
+		last = s->tail;
+		moved = s->count - index;
+	} else if (first) {
+		while (last && (last->node != to)) {
+			last = last->next;
+			moved++;
+		}
+	}
+
+	if (pos) {
+		after = d->head;
+		while (after && (after->node != pos))
+			after = after->next;
+	}
+
+	if ((first == NULL) || (last == NULL) || (pos && (after == NULL))) {
+		unlock_two(dest, src);
+		op_end(dest, LLIST_OP_RESTRUCTURE, 0);
+		return LLIST_NODE_NOT_FOUND;
+	}
+
+	// unlink from src
+	if (before)
+		before->next = last->next;
+	else
+		s->head = last->next;
+
+	if (s->tail == last)
+		s->tail = before;
+
+	s->count -= moved;
+
+	// and link into dest
+	if (after) {
+		last->next = after->next;
+		after->next = first;
+	} else {
+		last->next = d->head;
+		d->head = first;
+	}
+
+	if (last->next == NULL)
+		d->tail = last;
+
+	d->count += moved;
+
+	list_modified(dest);
+	list_modified(src);
+
+	unlock_two(dest, src);
+	op_end(dest, LLIST_OP_RESTRUCTURE, moved);
+
+	return LLIST_SUCCESS;
+}
+
+int llist_partition(llist list, node_predicate pred, void *arg,
+		    llist out_true, llist out_false)
+{
+	_list_node *iterator, *next;
+	_list_node *true_head = NULL, *true_tail = NULL;
+	_list_node *false_head = NULL, *false_tail = NULL;
+	unsigned int true_count = 0, count;
+
+	if ((list == NULL) || (pred == NULL) || (out_true == NULL) ||
+	    (out_false == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(list) || !chained(out_true) ||
+	    !chained(out_false))
+		return LLIST_NOT_IMPLEMENTED;
+
+	if ((list == out_true) || (list == out_false) ||
+	    (out_true == out_false))
+		return LLIST_ERROR;
+
+	_llist *thelist = (_llist *) list;
+
+	op_begin(list, LLIST_OP_RESTRUCTURE);
+	write_lock_three(list, out_true, out_false);
+
+	count = thelist->count;
+
+	for (iterator = thelist->head; iterator; iterator = next) {
+		next = iterator->next;
 
-	if (((_llist *) list)->count) {      // There exists at least one node
-		tempwrapper = ((_llist *) list)->head;
-		tempnode = tempwrapper->node;
-		((_llist *) list)->head = ((_llist *) list)->head->next;
-		((_llist *) list)->count--;
-		free(tempwrapper);
+		if (pred(iterator->node, arg)) {
+			if (true_tail)
+				true_tail->next = iterator;
+			else
+				true_head = iterator;
 
-		if (((_llist *) list)->count == 0)      // We've deleted the last node
-			((_llist *) list)->tail = NULL;
+			true_tail = iterator;
+			true_count++;
+		} else {
+			if (false_tail)
+				false_tail->next = iterator;
+			else
+				false_head = iterator;
+
+			false_tail = iterator;
+		}
 	}
 
-	unlock(list);
+	if (true_head)
+		append_chain(out_true, true_head, true_tail, true_count);
 
-	return tempnode;
+	if (false_head)
+		append_chain(out_false, false_head, false_tail,
+			     count - true_count);
+
+	thelist->head = thelist->tail = NULL;
+	thelist->count = 0;
+	list_modified(list);
+
+	unlock_three(list, out_true, out_false);
+	op_end(list, LLIST_OP_RESTRUCTURE, count);
+
+	return LLIST_SUCCESS;
 }
 
-int llist_concat(llist first, llist second)
+typedef enum {
+	SET_INTERSECT,
+	SET_DIFFERENCE,
+	SET_UNION
+} _set_op;
+
+// Wrappers taken out of the source lists, in order
+typedef struct {
+	_list_node *head;
+	_list_node *tail;
+	unsigned int count;
+} _chain;
+
+static inline void chain_append(_chain *chain, _list_node *wrapper)
 {
-	_list_node *end_node;
+	if (chain->tail)
+		chain->tail->next = wrapper;
+	else
+		chain->head = wrapper;
 
-	if ((first == NULL) || (second == NULL))
-		return LLIST_NULL_ARGUMENT;
+	chain->tail = wrapper;
+	chain->count++;
+}
 
-	write_lock_two(first, second);
+// Move all of list to the taken chain
+static void chain_take_all(_chain *chain, _llist *list)
+{
+	if (list->head == NULL)
+		return;
 
-	end_node = ((_llist *) first)->tail;
+	if (chain->tail)
+		chain->tail->next = list->head;
+	else
+		chain->head = list->head;
 
-	((_llist *) first)->count += ((_llist *) second)->count;
+	chain->tail = list->tail;
+	chain->count += list->count;
 
-	if (((_llist *) second)->head != NULL) {  // nothing to do for an empty second
-		if (end_node != NULL)  // first is not empty, link the chains
-			end_node->next = ((_llist *) second)->head;
-		else                   // first is empty, adopt second's head
-			((_llist *) first)->head = ((_llist *) second)->head;
+	list->head = list->tail = NULL;
+	list->count = 0;
+}
 
-		// the concatenated list ends where the second list ended
-		((_llist *) first)->tail = ((_llist *) second)->tail;
+static int set_hashed(_llist *first, _llist *second, node_hash hash_func,
+		      _set_op op, _chain *taken)
+{
+	_list_node **link, *iterator, *prev = NULL;
+	_llist *walked = first;
+	_hash_slot *table;
+	unsigned long mask, hash;
+	bool take;
+
+	if (op == SET_UNION)
+		table = alloc_hash_set(first->count + second->count, &mask);
+	else
+		table = alloc_hash_set(second->count, &mask);
+
+	if (table == NULL)
+		return LLIST_MALLOC_ERROR;
+
+	if (op == SET_UNION) {
+		for (iterator = first->head; iterator; iterator = iterator->next)
+			hash_set_insert(table, mask, first->equal_func,
+					hash_func(iterator->node), iterator);
+
+		chain_take_all(taken, first);
+		walked = second;
+	} else {
+		for (iterator = second->head; iterator; iterator = iterator->next)
+			hash_set_insert(table, mask, first->equal_func,
+					hash_func(iterator->node), iterator);
 	}
 
-	// Delete the nodes from the second list. (not really deletes them, only loses their reference.
-	((_llist *) second)->count = 0;
-	((_llist *) second)->head = ((_llist *) second)->tail = NULL;
+	link = &walked->head;
+	while ((iterator = *link) != NULL) {
+		hash = hash_func(iterator->node);
 
-	unlock_two(first, second);
+		if (op == SET_UNION)
+			take = !hash_set_insert(table, mask, first->equal_func,
+						hash, iterator);
+		else
+			take = (hash_set_slot(table, mask, first->equal_func,
+					      hash, iterator->node)->wrapper !=
+				NULL) == (op == SET_INTERSECT);
+
+		if (take) {
+			*link = iterator->next;
+			chain_append(taken, iterator);
+			walked->count--;
+		} else {
+			prev = iterator;
+			link = &iterator->next;
+		}
+	}
+
+	walked->tail = prev;
+	free(table);
 
 	return LLIST_SUCCESS;
 }
 
+// comp_func in the order first is sorted in
+static inline int sorted_order(_llist *list, llist_node first,
+			       llist_node second)
+{
+	return list->sorted * list->comp_func(first, second);
+}
+
+static void set_merged(_llist *first, _llist *second, _set_op op,
+		       _chain *taken)
+{
+	_list_node **link, *iterator, *prev = NULL, *other, *next;
+	bool take;
+	int order;
+
+	if (op != SET_UNION) {
+		other = second->head;
+		link = &first->head;
+		while ((iterator = *link) != NULL) {
+			while (other && (sorted_order(first, other->node,
+						      iterator->node) < 0))
+				other = other->next;
+
+			take = (other && (sorted_order(first, other->node,
+						       iterator->node) == 0)) ==
+			       (op == SET_INTERSECT);
+
+			if (take) {
+				*link = iterator->next;
+				chain_append(taken, iterator);
+				first->count--;
+			} else {
+				prev = iterator;
+				link = &iterator->next;
+			}
+		}
+
+		first->tail = prev;
+		return;
+	}
+
+	// the usual merge, except that nodes of second equal to the one
+	// before, or to the next one of first, stay in second
+	other = first->head;
+	link = &second->head;
+	while (((iterator = *link) != NULL) || other) {
+		if (iterator == NULL)
+			order = 1;
+		else if (other == NULL)
+			order = -1;
+		else
+			order = sorted_order(first, iterator->node,
+					     other->node);
+
+		if (order > 0) {
+			next = other->next;
+			chain_append(taken, other);
+			other = next;
+		} else if ((order == 0) ||
+			   (taken->tail && (sorted_order(first,
+							 taken->tail->node,
+							 iterator->node) == 0))) {
+			prev = iterator;
+			link = &iterator->next;
+		} else {
+			*link = iterator->next;
+			chain_append(taken, iterator);
+			second->count--;
+		}
+	}
+
+	second->tail = prev;
+	first->head = first->tail = NULL;
+	first->count = 0;
+}
+
+static int set_operation(llist first, llist second, node_hash hash_func,
+			 llist out, _set_op op)
+{
+	_llist *one = (_llist *) first, *two = (_llist *) second;
+	_llist *theout = (_llist *) out;
+	_chain taken = { NULL, NULL, 0 };
+	unsigned int count_one, count_two;
+	bool was_empty;
+	int sorted, rc = LLIST_SUCCESS;
+
+	if ((first == NULL) || (second == NULL) || (out == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(first) || !chained(second) || !chained(out))
+		return LLIST_NOT_IMPLEMENTED;
+
+	if ((first == second) || (first == out) || (second == out))
+		return LLIST_ERROR;
+
+	if (hash_func && (one->equal_func == NULL))
+		return LLIST_EQUAL_MISSING;
+
+	op_begin(first, LLIST_OP_RESTRUCTURE);
+	write_lock_three(first, second, out);
+
+	count_one = one->count;
+	count_two = two->count;
+	was_empty = (theout->count == 0);
+	sorted = one->sorted;
+
+	if (hash_func)
+		rc = set_hashed(one, two, hash_func, op, &taken);
+	else if (sorted && (two->sorted == sorted) &&
+		 (one->comp_func == two->comp_func))
+		set_merged(one, two, op, &taken);
+	else
+		rc = LLIST_ERROR;
+
+	if (taken.head) {
+		if (one->count != count_one)
+			list_shrunk(one);
+		if (two->count != count_two)
+			list_shrunk(two);
+
+		append_chain(theout, taken.head, taken.tail, taken.count);
+
+		if (!hash_func && was_empty &&
+		    (theout->comp_func == one->comp_func)) {
+			theout->sorted = sorted;
+			build_sorted_index(theout);
+		}
+	}
+
+	unlock_three(first, second, out);
+	op_end(first, LLIST_OP_RESTRUCTURE, count_one + count_two);
+
+	return rc;
+}
+
+int llist_intersect(llist first, llist second, node_hash hash_func,
+		    llist out)
+{
+	return set_operation(first, second, hash_func, out, SET_INTERSECT);
+}
+
+int llist_difference(llist first, llist second, node_hash hash_func,
+		     llist out)
+{
+	return set_operation(first, second, hash_func, out, SET_DIFFERENCE);
+}
+
+int llist_union(llist first, llist second, node_hash hash_func, llist out)
+{
+	return set_operation(first, second, hash_func, out, SET_UNION);
+}
+
 int llist_reverse(llist list)
 {
 	if (list == NULL)
 		return LLIST_NULL_ARGUMENT;
 
+	if (!chained(list))
+		return LLIST_NOT_IMPLEMENTED;
+
+	op_begin(list, LLIST_OP_RESTRUCTURE);
 	write_lock(list);
 
 	_list_node *iterator = ((_llist *) list)->head;
 	_list_node *nextnode = NULL;
 	_list_node *temp = NULL;
+	unsigned int count = ((_llist *) list)->count;
 
 	/*
 	 * Swap our Head & Tail pointers
 	 */
 	((_llist *) list)->head = ((_llist *) list)->tail;
 	((_llist *) list)->tail = iterator;
+	list_modified(list);
 
 	/*
 	 * Swap the internals
@@ -581,30 +3766,394 @@ int llist_reverse(llist list)
 	}
 
 	unlock(list);
+	op_end(list, LLIST_OP_RESTRUCTURE, count);
+
+	return LLIST_SUCCESS;
+}
+
+int llist_compact(llist list, node_move move, void *arg)
+{
+	_list_node *iterator, *next;
+	_slab *slab;
+	unsigned int i, count;
+	int sorted;
+
+	if (list == NULL)
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(list))
+		return LLIST_NOT_IMPLEMENTED;
+
+	_llist *thelist = (_llist *) list;
+
+	op_begin(list, LLIST_OP_RESTRUCTURE);
+	write_lock(list);
+
+	count = thelist->count;
+	if (count == 0) {
+		unlock(list);
+		op_end(list, LLIST_OP_RESTRUCTURE, 0);
+		return LLIST_SUCCESS;
+	}
+
+	slab = malloc(sizeof(_slab) + count * sizeof(_list_node));
+	if (slab == NULL) {
+		unlock(list);
+		op_end(list, LLIST_OP_RESTRUCTURE, 0);
+		return LLIST_MALLOC_ERROR;
+	}
+
+	stat_alloc(list);
+
+	slab->live = count;
+
+	iterator = thelist->head;
+	for (i = 0; i < count; i++) {
+		slab->nodes[i].node = move ? move(iterator->node, arg) :
+				      iterator->node;
+		slab->nodes[i].next = &slab->nodes[i + 1];
+		slab->nodes[i].slab = slab;
+
+		next = iterator->next;
+		free_wrapper(iterator);
+		iterator = next;
+	}
+
+	slab->nodes[count - 1].next = NULL;
+	thelist->head = &slab->nodes[0];
+	thelist->tail = &slab->nodes[count - 1];
+
+	// the order didn't change, only the sampled wrappers moved
+	sorted = thelist->sorted;
+	list_modified(list);
+	if (sorted) {
+		thelist->sorted = sorted;
+		build_sorted_index(thelist);
+	}
+
+	unlock(list);
+	op_end(list, LLIST_OP_RESTRUCTURE, count);
+
+	return LLIST_SUCCESS;
+}
+
+/*
+ * Serialized list format, all integers little endian:
+ *   magic "LLST" | u32 version | u64 node count
+ * followed by one record per node: u32 length | encoded node
+ */
+#define LLIST_SERIAL_MAGIC "LLST"
+#define LLIST_SERIAL_VERSION 1
+
+// wrappers allocated at once while reading, the header count isn't trusted
+#define LLIST_SERIAL_CHUNK 1024
+
+// record bytes read before the buffer is grown further, for the same reason
+#define LLIST_SERIAL_PIECE 4096
+
+static void put_le(unsigned char *buf, unsigned long long value,
+		   unsigned int size)
+{
+	unsigned int i;
+
+	for (i = 0; i < size; i++)
+		buf[i] = (value >> (8 * i)) & 0xff;
+}
+
+static unsigned long long get_le(const unsigned char *buf, unsigned int size)
+{
+	unsigned long long value = 0;
+	unsigned int i;
+
+	for (i = 0; i < size; i++)
+		value |= (unsigned long long) buf[i] << (8 * i);
+
+	return value;
+}
+
+static int reserve_buffer(unsigned char **buf, size_t *size, size_t len)
+{
+	unsigned char *temp;
+
+	if (len <= *size)
+		return LLIST_SUCCESS;
+
+	temp = realloc(*buf, len);
+	if (temp == NULL)
+		return LLIST_MALLOC_ERROR;
+
+	*buf = temp;
+	*size = len;
+
+	return LLIST_SUCCESS;
+}
+
+/*
+ * Read a len bytes record into buf. The length comes from the file, so the
+ * buffer only grows (by doubling) as the data actually shows up: a bogus
+ * length fails on the end of the file, not on a huge allocation.
+ */
+static int read_payload(FILE *file, unsigned char **buf, size_t *size,
+			size_t len)
+{
+	size_t done = 0, target;
+	int rc;
+
+	while (done < len) {
+		target = (done < LLIST_SERIAL_PIECE) ? LLIST_SERIAL_PIECE :
+			 2 * done;
+		if (target > len)
+			target = len;
+
+		rc = reserve_buffer(buf, size, target);
+		if (rc != LLIST_SUCCESS)
+			return rc;
+
+		if (fread(*buf + done, target - done, 1, file) != 1)
+			return LLIST_ERROR;
+
+		done = target;
+	}
+
+	return LLIST_SUCCESS;
+}
+
+int llist_serialize(llist list, FILE *file, node_encoder encoder)
+{
+	_list_node *iterator;
+	unsigned char header[16], *buf = NULL;
+	size_t size = 0, len;
+	unsigned int count;
+	int rc = LLIST_SUCCESS;
+
+	if ((list == NULL) || (file == NULL) || (encoder == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(list))
+		return LLIST_NOT_IMPLEMENTED;
+
+	op_begin(list, LLIST_OP_TRAVERSE);
+	read_lock(list);
+
+	count = ((_llist *) list)->count;
+
+	memcpy(header, LLIST_SERIAL_MAGIC, 4);
+	put_le(header + 4, LLIST_SERIAL_VERSION, 4);
+	put_le(header + 8, count, 8);
+
+	if (fwrite(header, sizeof(header), 1, file) != 1)
+		rc = LLIST_ERROR;
+
+	for (iterator = ((_llist *) list)->head;
+	     (iterator != NULL) && (rc == LLIST_SUCCESS);
+	     iterator = iterator->next) {
+		// the record header goes in front of the encoded node
+		len = encoder(iterator->node, buf ? buf + 4 : NULL,
+			      size ? size - 4 : 0);
+		if (len + 4 > size) {
+			rc = reserve_buffer(&buf, &size, len + 4);
+			if (rc != LLIST_SUCCESS)
+				break;
+
+			len = encoder(iterator->node, buf + 4, size - 4);
+		}
+
+		if (len > UINT32_MAX) {
+			rc = LLIST_ERROR;
+			break;
+		}
+
+		put_le(buf, len, 4);
+		if (fwrite(buf, len + 4, 1, file) != 1)
+			rc = LLIST_ERROR;
+	}
+
+	unlock(list);
+	op_end(list, LLIST_OP_TRAVERSE, count);
+
+	free(buf);
+
+	if ((rc == LLIST_SUCCESS) && fflush(file))
+		rc = LLIST_ERROR;
+
+	return rc;
+}
+
+int llist_deserialize(llist list, FILE *file, node_decoder decoder,
+		      node_func destructor)
+{
+	_llist *thelist = (_llist *) list;
+	_list_node *first = NULL, *last = NULL, *wrapper, *next;
+	unsigned char header[16], *buf = NULL;
+	unsigned long long count;
+	size_t size = 0, len;
+	_slab *slab = NULL;
+	unsigned int i, used = 0, chunk = 0;
+	llist_node node;
+	int rc = LLIST_SUCCESS;
+
+	if ((list == NULL) || (file == NULL) || (decoder == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(list))
+		return LLIST_NOT_IMPLEMENTED;
+
+	if ((fread(header, sizeof(header), 1, file) != 1) ||
+	    memcmp(header, LLIST_SERIAL_MAGIC, 4) ||
+	    (get_le(header + 4, 4) != LLIST_SERIAL_VERSION))
+		return LLIST_ERROR;
+
+	count = get_le(header + 8, 8);
+	if (count > UINT_MAX)
+		return LLIST_ERROR;
+
+	if (count == 0)
+		return LLIST_SUCCESS;
+
+	op_begin(list, LLIST_OP_ADD);
+
+	// don't decode anything the list couldn't count, checked again below
+	if (read_lock(list)) {
+		op_end(list, LLIST_OP_ADD, 0);
+		return LLIST_MULTITHREAD_ISSUE;
+	}
+
+	if (count > UINT_MAX - thelist->count)
+		rc = LLIST_ERROR;
+
+	unlock(list);
+
+	/*
+	 * Decode everything before touching the list. Wrappers come in
+	 * blocks the same way llist_compact() allocates them, a block at a
+	 * time so that a short file fails before much is allocated.
+	 */
+	for (i = 0; (rc == LLIST_SUCCESS) && (i < count); i++) {
+		unsigned char record[4];
+
+		if (fread(record, sizeof(record), 1, file) != 1) {
+			rc = LLIST_ERROR;
+			break;
+		}
+
+		len = get_le(record, 4);
+		rc = read_payload(file, &buf, &size, len);
+		if (rc != LLIST_SUCCESS)
+			break;
+
+		if (used == chunk) {
+			chunk = (count - i < LLIST_SERIAL_CHUNK) ? count - i :
+				LLIST_SERIAL_CHUNK;
+			slab = malloc(sizeof(_slab) + chunk * sizeof(_list_node));
+			if (slab == NULL) {
+				rc = LLIST_MALLOC_ERROR;
+				break;
+			}
+
+			stat_alloc(list);
+			slab->live = 0;
+			used = 0;
+		}
+
+		node = decoder(buf, len);
+		if (node == NULL) {
+			rc = LLIST_ERROR;
+			break;
+		}
+
+		wrapper = &slab->nodes[used++];
+		wrapper->node = node;
+		wrapper->next = NULL;
+		wrapper->slab = slab;
+		slab->live++;
+
+		if (last)
+			last->next = wrapper;
+		else
+			first = wrapper;
+		last = wrapper;
+	}
+
+	free(buf);
+
+	if (rc != LLIST_SUCCESS)
+		goto discard;
+
+	write_lock(list);
+
+	// the list may have grown while decoding
+	if (count > UINT_MAX - thelist->count) {
+		unlock(list);
+		rc = LLIST_ERROR;
+		goto discard;
+	}
+
+	if (thelist->tail)
+		thelist->tail->next = first;
+	else
+		thelist->head = first;
+
+	thelist->tail = last;
+	thelist->count += count;
+	list_modified(list);
+
+	unlock(list);
+	op_end(list, LLIST_OP_ADD, count);
+
+	return LLIST_SUCCESS;
+
+discard:
+	// a block that didn't get a node yet isn't reached through the chain
+	if (slab && (slab->live == 0))
+		free(slab);
+
+	for (wrapper = first; wrapper; wrapper = next) {
+		next = wrapper->next;
+
+		if (destructor)
+			destructor(wrapper->node);
+		else
+			free(wrapper->node);
+
+		free_wrapper(wrapper);
+	}
+
+	op_end(list, LLIST_OP_ADD, 0);
 
-	return LLIST_SUCCESS;
+	return rc;
 }
 
 int llist_sort(llist list, int flags)
 {
 
 	comperator cmp;
+	unsigned int count;
 
 	if (list == NULL)
 		return LLIST_NULL_ARGUMENT;
 
+	if (!chained(list))
+		return LLIST_NOT_IMPLEMENTED;
+
 	_llist *thelist = (_llist *) list;
 
 	cmp =  thelist->comp_func;
 	if (cmp == NULL)
 		return LLIST_COMPERATOR_MISSING;
 
+	op_begin(list, LLIST_OP_SORT);
 	write_lock(list);
+	count = thelist->count;
 	// listsort() dereferences the tail unconditionally, guard the empty list
 	if (thelist->head != NULL)
 		thelist->head = listsort(thelist->head, &thelist->tail, cmp,
 					 flags);
+
+	list_modified(list);
+	thelist->sorted = (flags & SORT_LIST_ASCENDING) ? 1 : -1;
+	build_sorted_index(thelist);
 	unlock(list);
+	op_end(list, LLIST_OP_SORT, count);
 
 	return LLIST_SUCCESS;
 }
@@ -636,6 +4185,9 @@ static _list_node *listsort(_list_node *list, _list_node **updated_tail,
 				if (!q) {
 					break;
 				}
+				/* this walk runs ahead of the merge below,
+				 * get the payloads it compares on their way */
+				prefetch(q->node);
 			}
 
 			/* if q hasn't fallen off end, we have two lists to merge */
@@ -696,30 +4248,358 @@ static _list_node *listsort(_list_node *list, _list_node **updated_tail,
 	return list;
 }
 
+/*
+ * Sample every LLIST_SORTED_INDEX_STRIDE-th wrapper of a freshly sorted list.
+ * Failing to allocate the index isn't an error, llist_find_sorted() just
+ * falls back to a linear scan.
+ */
+static void build_sorted_index(_llist *list)
+{
+	_list_node *iterator;
+	unsigned int i, size;
+
+	size = (list->count + LLIST_SORTED_INDEX_STRIDE - 1) /
+	       LLIST_SORTED_INDEX_STRIDE;
+	if (size == 0)
+		return;
+
+	list->index = malloc(size * sizeof(_list_node *));
+	if (list->index == NULL)
+		return;
+
+	iterator = list->head;
+	for (i = 0; iterator != NULL; i++, iterator = iterator->next)
+		if ((i % LLIST_SORTED_INDEX_STRIDE) == 0)
+			list->index[i / LLIST_SORTED_INDEX_STRIDE] = iterator;
+
+	list->index_size = size;
+}
+
+int llist_find_sorted(llist list, void *data, llist_node *found)
+{
+	_list_node *iterator;
+	unsigned int low, high, mid;
+	comperator cmp;
+	int direction, rc;
+	unsigned int scanned = 0;
+
+	if ((list == NULL) || (found == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(list))
+		return LLIST_NOT_IMPLEMENTED;
+
+	_llist *thelist = (_llist *) list;
+
+	cmp = thelist->comp_func;
+	if (cmp == NULL)
+		return LLIST_COMPERATOR_MISSING;
+
+	op_begin(list, LLIST_OP_FIND);
+	read_lock(list);
+
+	direction = thelist->sorted;
+	iterator = thelist->head;
+
+	if (thelist->index) {
+		// find the first sample that isn't before data
+		low = 0;
+		high = thelist->index_size;
+		while (low < high) {
+			mid = low + (high - low) / 2;
+			if (direction * cmp(thelist->index[mid]->node, data) < 0)
+				low = mid + 1;
+			else
+				high = mid;
+		}
+
+		// a match, if any, can't be before the preceding sample
+		if (low > 0)
+			iterator = thelist->index[low - 1];
+	}
+
+	while (iterator != NULL) {
+		scanned++;
+		rc = cmp(iterator->node, data);
+		if (rc == 0) {
+			*found = iterator->node;
+			unlock(list);
+			op_end(list, LLIST_OP_FIND, scanned);
+			return LLIST_SUCCESS;
+		}
+
+		// passed the place it should have been in
+		if (direction * rc > 0)
+			break;
+
+		iterator = iterator->next;
+	}
+
+	unlock(list);
+	op_end(list, LLIST_OP_FIND, scanned);
+
+	return LLIST_NODE_NOT_FOUND;
+}
+
+/*
+ * Bounded heap helpers for llist_top_k() and llist_partial_sort().
+ * The heap holds the k best wrappers seen so far with the worst of them at
+ * the root, so every other candidate costs a single comparison.
+ */
+static void heap_sift_down(_list_node **heap, unsigned int size,
+			   unsigned int i, comperator cmp, int direction)
+{
+	unsigned int child;
+	_list_node *temp;
+
+	while ((child = 2 * i + 1) < size) {
+		if ((child + 1 < size) &&
+		    (direction * cmp(heap[child + 1]->node,
+				     heap[child]->node) > 0))
+			child++;
+
+		if (direction * cmp(heap[child]->node, heap[i]->node) <= 0)
+			break;
+
+		temp = heap[i];
+		heap[i] = heap[child];
+		heap[child] = temp;
+		i = child;
+	}
+}
+
+static void heap_sift_up(_list_node **heap, unsigned int i, comperator cmp,
+			 int direction)
+{
+	unsigned int parent;
+	_list_node *temp;
+
+	while (i > 0) {
+		parent = (i - 1) / 2;
+
+		if (direction * cmp(heap[i]->node, heap[parent]->node) <= 0)
+			break;
+
+		temp = heap[i];
+		heap[i] = heap[parent];
+		heap[parent] = temp;
+		i = parent;
+	}
+}
+
+/*
+ * Walk the chain starting at iterator and keep the k best wrappers in heap.
+ * If rest is not NULL every wrapper that didn't make it (or was evicted) is
+ * relinked into a chain starting at *rest and ending at *rest_tail.
+ * Returns the number of wrappers in the heap.
+ */
+static unsigned int heap_select(_list_node *iterator, _list_node **heap,
+				unsigned int k, comperator cmp, int direction,
+				_list_node **rest, _list_node **rest_tail)
+{
+	unsigned int size = 0;
+	_list_node *next, *evicted;
+
+	if (rest) {
+		*rest = NULL;
+		*rest_tail = NULL;
+	}
+
+	while (iterator) {
+		next = iterator->next;
+		evicted = iterator;
+
+		if (size < k) {
+			heap[size] = iterator;
+			heap_sift_up(heap, size, cmp, direction);
+			size++;
+			evicted = NULL;
+		} else if ((k > 0) &&
+			   (direction * cmp(iterator->node, heap[0]->node) < 0)) {
+			evicted = heap[0];
+			heap[0] = iterator;
+			heap_sift_down(heap, size, 0, cmp, direction);
+		}
+
+		if (evicted && rest) {
+			if (*rest_tail)
+				(*rest_tail)->next = evicted;
+			else
+				*rest = evicted;
+
+			*rest_tail = evicted;
+		}
+
+		iterator = next;
+	}
+
+	if (rest && *rest_tail)
+		(*rest_tail)->next = NULL;
+
+	return size;
+}
+
+// Turn the heap built by heap_select() into a sorted array, in place
+static void heap_sort_selected(_list_node **heap, unsigned int size,
+			       comperator cmp, int direction)
+{
+	_list_node *temp;
+
+	while (size > 1) {
+		size--;
+		temp = heap[0];
+		heap[0] = heap[size];
+		heap[size] = temp;
+		heap_sift_down(heap, size, 0, cmp, direction);
+	}
+}
+
+int llist_top_k(llist list, unsigned int k, int flags, llist_node *out)
+{
+	_list_node **heap;
+	unsigned int size, i, count;
+	comperator cmp;
+	int direction = (flags & SORT_LIST_ASCENDING) ? 1 : -1;
+
+	if ((list == NULL) || (out == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(list))
+		return LLIST_NOT_IMPLEMENTED;
+
+	cmp = ((_llist *) list)->comp_func;
+	if (cmp == NULL)
+		return LLIST_COMPERATOR_MISSING;
+
+	op_begin(list, LLIST_OP_TRAVERSE);
+	read_lock(list);
+	count = ((_llist *) list)->count;
+
+	// there's no point in a heap larger than the list itself
+	size = ((_llist *) list)->count < k ? ((_llist *) list)->count : k;
+
+	heap = NULL;
+	if (size > 0) {
+		heap = malloc(size * sizeof(_list_node *));
+		if (heap == NULL) {
+			unlock(list);
+			op_end(list, LLIST_OP_TRAVERSE, 0);
+			return LLIST_MALLOC_ERROR;
+		}
+
+		size = heap_select(((_llist *) list)->head, heap, size, cmp,
+				   direction, NULL, NULL);
+		heap_sort_selected(heap, size, cmp, direction);
+	}
+
+	for (i = 0; i < size; i++)
+		out[i] = heap[i]->node;
+
+	unlock(list);
+	op_end(list, LLIST_OP_TRAVERSE, count);
+
+	for (; i < k; i++)
+		out[i] = NULL;
+
+	free(heap);
+
+	return LLIST_SUCCESS;
+}
+
+int llist_partial_sort(llist list, unsigned int k, int flags)
+{
+	_list_node **heap;
+	_list_node *rest, *rest_tail;
+	unsigned int size, i, count;
+	comperator cmp;
+	int direction = (flags & SORT_LIST_ASCENDING) ? 1 : -1;
+
+	if (list == NULL)
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(list))
+		return LLIST_NOT_IMPLEMENTED;
+
+	_llist *thelist = (_llist *) list;
+
+	cmp = thelist->comp_func;
+	if (cmp == NULL)
+		return LLIST_COMPERATOR_MISSING;
+
+	op_begin(list, LLIST_OP_SORT);
+	write_lock(list);
+	count = thelist->count;
+
+	size = thelist->count < k ? thelist->count : k;
+	if (size == 0) {
+		unlock(list);
+		op_end(list, LLIST_OP_SORT, 0);
+		return LLIST_SUCCESS;
+	}
+
+	heap = malloc(size * sizeof(_list_node *));
+	if (heap == NULL) {
+		unlock(list);
+		op_end(list, LLIST_OP_SORT, 0);
+		return LLIST_MALLOC_ERROR;
+	}
+
+	size = heap_select(thelist->head, heap, size, cmp, direction, &rest,
+			   &rest_tail);
+	heap_sort_selected(heap, size, cmp, direction);
+
+	// relink: the selected nodes in order, followed by everything else
+	for (i = 0; i + 1 < size; i++)
+		heap[i]->next = heap[i + 1];
+
+	heap[size - 1]->next = rest;
+	thelist->head = heap[0];
+	thelist->tail = rest_tail ? rest_tail : heap[size - 1];
+	list_modified(list);
+
+	unlock(list);
+	op_end(list, LLIST_OP_SORT, count);
+
+	free(heap);
+
+	return LLIST_SUCCESS;
+}
+
 static int llist_get_min_max(llist list, llist_node *output, bool max)
 {
 	comperator cmp;
+	unsigned int count;
 
 	if (list == NULL)
 		return LLIST_NULL_ARGUMENT;
 
+	if (!chained(list))
+		return LLIST_NOT_IMPLEMENTED;
+
 	cmp = ((_llist *) list)->comp_func;
 
 	if (cmp == NULL)
 		return LLIST_COMPERATOR_MISSING;
 
+	op_begin(list, LLIST_OP_TRAVERSE);
 	read_lock(list);
+	count = ((_llist *) list)->count;
 
 	_list_node *iterator = ((_llist *) list)->head;
+	_list_node *ahead;
 
 	if (iterator == NULL) {   // empty list, there's no min/max
 		unlock(list);
+		op_end(list, LLIST_OP_TRAVERSE, 0);
 		return LLIST_NODE_NOT_FOUND;
 	}
 
 	*output = iterator->node;
 	iterator = iterator->next;
+	ahead = prefetch_start(iterator);
 	while (iterator) {
+		ahead = prefetch_step(ahead);
+
 		if (max) { // Find maximum
 			if (cmp(iterator->node, *output) > 0) {
 				*output = iterator->node;
@@ -733,6 +4613,7 @@ static int llist_get_min_max(llist list, llist_node *output, bool max)
 	}
 
 	unlock(list);
+	op_end(list, LLIST_OP_TRAVERSE, count);
 
 	return LLIST_SUCCESS;
 }
@@ -747,6 +4628,139 @@ int llist_get_min(llist list, llist_node *min)
 	return llist_get_min_max(list, min, false);
 }
 
+/*
+ * Single pass min/max scan. Nodes are taken in pairs: the pair is ordered
+ * with one comparison, then only the smaller one is compared against the
+ * minimum and the larger one against the maximum, 3 comparisons per 2 nodes.
+ * Ties keep the first occurrence, like llist_get_min_max() does.
+ * cmp may be NULL, in which case only fold and count are done.
+ */
+static unsigned int min_max_scan(_list_node *iterator, comperator cmp,
+				 llist_node *min, llist_node *max,
+				 node_func_arg fold, void *acc)
+{
+	unsigned int count = 0;
+	llist_node first, second, small, big;
+	_list_node *ahead;
+	int rc;
+
+	*min = *max = NULL;
+
+	if (iterator == NULL)
+		return 0;
+
+	if (fold)
+		fold(iterator->node, acc);
+
+	*min = *max = iterator->node;
+	iterator = iterator->next;
+	count++;
+	ahead = prefetch_start(iterator);
+
+	while (iterator) {
+		ahead = prefetch_step(prefetch_step(ahead));
+
+		first = iterator->node;
+		iterator = iterator->next;
+
+		if (iterator == NULL) { // odd one out
+			if (fold)
+				fold(first, acc);
+
+			if (cmp) {
+				if (cmp(first, *min) < 0)
+					*min = first;
+				else if (cmp(first, *max) > 0)
+					*max = first;
+			}
+			count++;
+			break;
+		}
+
+		second = iterator->node;
+		iterator = iterator->next;
+
+		if (fold) {
+			fold(first, acc);
+			fold(second, acc);
+		}
+
+		if (cmp) {
+			rc = cmp(first, second);
+			small = (rc > 0) ? second : first;
+			big = (rc < 0) ? second : first;
+
+			if (cmp(small, *min) < 0)
+				*min = small;
+
+			if (cmp(big, *max) > 0)
+				*max = big;
+		}
+		count += 2;
+	}
+
+	if (cmp == NULL)
+		*min = *max = NULL;
+
+	return count;
+}
+
+int llist_get_min_max_both(llist list, llist_node *min, llist_node *max)
+{
+	comperator cmp;
+	unsigned int count;
+
+	if ((list == NULL) || (min == NULL) || (max == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(list))
+		return LLIST_NOT_IMPLEMENTED;
+
+	cmp = ((_llist *) list)->comp_func;
+
+	if (cmp == NULL)
+		return LLIST_COMPERATOR_MISSING;
+
+	op_begin(list, LLIST_OP_TRAVERSE);
+	read_lock(list);
+	count = ((_llist *) list)->count;
+
+	if (((_llist *) list)->head == NULL) {   // empty list, there's no min/max
+		unlock(list);
+		op_end(list, LLIST_OP_TRAVERSE, 0);
+		return LLIST_NODE_NOT_FOUND;
+	}
+
+	min_max_scan(((_llist *) list)->head, cmp, min, max, NULL, NULL);
+
+	unlock(list);
+	op_end(list, LLIST_OP_TRAVERSE, count);
+
+	return LLIST_SUCCESS;
+}
+
+int llist_aggregate(llist list, llist_aggregate_result *result,
+		    node_func_arg fold, void *acc)
+{
+	if ((list == NULL) || (result == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (!chained(list))
+		return LLIST_NOT_IMPLEMENTED;
+
+	op_begin(list, LLIST_OP_TRAVERSE);
+	read_lock(list);
+
+	result->count = min_max_scan(((_llist *) list)->head,
+				     ((_llist *) list)->comp_func,
+				     &result->min, &result->max, fold, acc);
+
+	unlock(list);
+	op_end(list, LLIST_OP_TRAVERSE, result->count);
+
+	return LLIST_SUCCESS;
+}
+
 bool llist_is_empty(llist list)
 {
 	return (!llist_size(list));
@@ -758,10 +4772,14 @@ int llist_merge(llist first, llist second)
 	_list_node *p1, *p2, *rest;
 	_list_node *merged_head = NULL, *merged_tail = NULL, *pick;
 	comperator cmp;
+	unsigned int count;
 
 	if ((first == NULL) || (second == NULL))
 		return LLIST_NULL_ARGUMENT;
 
+	if (!chained(first) || !chained(second))
+		return LLIST_NOT_IMPLEMENTED;
+
 	l1 = (_llist *) first;
 	l2 = (_llist *) second;
 
@@ -769,7 +4787,9 @@ int llist_merge(llist first, llist second)
 	if (cmp == NULL)
 		return LLIST_COMPERATOR_MISSING;
 
+	op_begin(first, LLIST_OP_SORT);
 	write_lock_two(first, second);
+	count = l1->count + l2->count;
 
 	p1 = l1->head;
 	p2 = l2->head;
@@ -819,7 +4839,76 @@ int llist_merge(llist first, llist second)
 	l2->head = l2->tail = NULL;
 	l2->count = 0;
 
+	list_modified(first);
+	list_modified(second);
+
 	unlock_two(first, second);
+	op_end(first, LLIST_OP_SORT, count);
+
+	return LLIST_SUCCESS;
+}
+
+int llist_get_stats(llist list, llist_stats *stats)
+{
+	_stats_shard *shard;
+	unsigned int i, j;
+
+	if ((list == NULL) || (stats == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	_llist *thelist = (_llist *) list;
+
+	if (thelist->stats == NULL)
+		return LLIST_ERROR;
+
+	op_begin(list, LLIST_OP_OTHER);
+
+	memset(stats, 0, sizeof(llist_stats));
+
+	for (i = 0; i < LLIST_STATS_SHARDS; i++) {
+		shard = &thelist->stats[i];
+
+		for (j = 0; j < LLIST_OP_COUNT; j++) {
+			stats->ops[j] += __atomic_load_n(&shard->ops[j],
+							 __ATOMIC_RELAXED);
+			stats->scanned[j] += __atomic_load_n(&shard->scanned[j],
+							     __ATOMIC_RELAXED);
+		}
+
+		for (j = 0; j < LLIST_LOCK_WAIT_BUCKETS; j++)
+			stats->lock_wait_histogram[j] +=
+				__atomic_load_n(&shard->lock_wait_histogram[j],
+						__ATOMIC_RELAXED);
+
+		stats->lock_acquisitions +=
+			__atomic_load_n(&shard->lock_acquisitions,
+					__ATOMIC_RELAXED);
+		stats->lock_contended +=
+			__atomic_load_n(&shard->lock_contended,
+					__ATOMIC_RELAXED);
+		stats->lock_wait_ns += __atomic_load_n(&shard->lock_wait_ns,
+						       __ATOMIC_RELAXED);
+		stats->allocations += __atomic_load_n(&shard->allocations,
+						      __ATOMIC_RELAXED);
+	}
+
+	stats->peak_size = __atomic_load_n(&thelist->peak_size,
+					   __ATOMIC_RELAXED);
+
+	trace_end(list, LLIST_OP_OTHER, 0);
+
+	return LLIST_SUCCESS;
+}
+
+int llist_set_trace_hooks(const llist_trace_hooks *hooks)
+{
+#ifdef LLIST_TRACE
+	__atomic_store_n(&trace_hooks, hooks, __ATOMIC_RELEASE);
 
 	return LLIST_SUCCESS;
+#else
+	(void) hooks;
+
+	return LLIST_NOT_IMPLEMENTED;
+#endif
 }
@@ -0,0 +1,488 @@
+/*
+ *    Copyright [2013] [Ramon Fried] <ramon.fried at gmail dot com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * External sort: nodes are collected in an in-memory list until their
+ * encoded size crosses mem_limit, then the list is sorted and spilled to a
+ * temporary file as a run. Finishing merges all the runs with a k-way heap,
+ * keeping only one decoded node per run in memory.
+ *
+ * Run format: every record is a 4 byte little endian length followed by the
+ * bytes produced by the user encoder.
+ */
+
+#include "../inc/llist.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+typedef struct {
+	FILE *file;
+	llist_node current;
+	bool done;
+} _sort_run;
+
+typedef struct {
+	comperator comp_func;
+	int flags;
+	size_t mem_limit;
+	size_t mem_used;
+	node_encoder encoder;
+	node_decoder decoder;
+	node_func destructor;
+
+	llist buffer;           // nodes that were not spilled yet
+
+	_sort_run *runs;
+	unsigned int nruns;
+	unsigned int runs_size;
+	bool merging;           // a finish stopped halfway, it can be resumed
+
+	unsigned char *scratch; // encode/decode buffer
+	size_t scratch_size;
+} _llist_sorter;
+
+static void destroy_node(_llist_sorter *sorter, llist_node node)
+{
+	if (sorter->destructor)
+		sorter->destructor(node);
+	else
+		free(node);
+}
+
+static int reserve_scratch(_llist_sorter *sorter, size_t len)
+{
+	unsigned char *temp;
+
+	if (len <= sorter->scratch_size)
+		return LLIST_SUCCESS;
+
+	temp = realloc(sorter->scratch, len);
+	if (temp == NULL)
+		return LLIST_MALLOC_ERROR;
+
+	sorter->scratch = temp;
+	sorter->scratch_size = len;
+
+	return LLIST_SUCCESS;
+}
+
+static int write_record(_llist_sorter *sorter, FILE *file, llist_node node)
+{
+	unsigned char header[4];
+	size_t len;
+	int rc;
+
+	len = sorter->encoder(node, sorter->scratch, sorter->scratch_size);
+	if (len > sorter->scratch_size) {
+		rc = reserve_scratch(sorter, len);
+		if (rc != LLIST_SUCCESS)
+			return rc;
+
+		len = sorter->encoder(node, sorter->scratch,
+				      sorter->scratch_size);
+		if (len > sorter->scratch_size)
+			return LLIST_ERROR;
+	}
+
+	if (len > UINT32_MAX)
+		return LLIST_ERROR;
+
+	header[0] = len & 0xff;
+	header[1] = (len >> 8) & 0xff;
+	header[2] = (len >> 16) & 0xff;
+	header[3] = (len >> 24) & 0xff;
+
+	if (fwrite(header, sizeof(header), 1, file) != 1)
+		return LLIST_ERROR;
+
+	if ((len > 0) && (fwrite(sorter->scratch, len, 1, file) != 1))
+		return LLIST_ERROR;
+
+	return LLIST_SUCCESS;
+}
+
+// Load the next node of a run into run->current, sets run->done at the end
+static int read_record(_llist_sorter *sorter, _sort_run *run)
+{
+	unsigned char header[4];
+	size_t len;
+	int rc;
+
+	run->current = NULL;
+
+	if (fread(header, sizeof(header), 1, run->file) != 1) {
+		if (!feof(run->file))
+			return LLIST_ERROR;
+
+		run->done = true;
+		return LLIST_SUCCESS;
+	}
+
+	len = (size_t) header[0] | ((size_t) header[1] << 8) |
+	      ((size_t) header[2] << 16) | ((size_t) header[3] << 24);
+
+	rc = reserve_scratch(sorter, len);
+	if (rc != LLIST_SUCCESS)
+		return rc;
+
+	if ((len > 0) && (fread(sorter->scratch, len, 1, run->file) != 1))
+		return LLIST_ERROR;
+
+	run->current = sorter->decoder(sorter->scratch, len);
+	if (run->current == NULL)
+		return LLIST_ERROR;
+
+	return LLIST_SUCCESS;
+}
+
+typedef struct {
+	_llist_sorter *sorter;
+	FILE *file;
+	int rc;
+} _spill_state;
+
+static bool spill_node(llist_node node, void *arg)
+{
+	_spill_state *state = arg;
+
+	state->rc = write_record(state->sorter, state->file, node);
+
+	return state->rc != LLIST_SUCCESS;
+}
+
+/*
+ * Sort whatever is in memory and write it out as a new run. The nodes are
+ * only destroyed once the whole run made it to the file, if anything fails
+ * the run is dropped and the nodes stay in memory.
+ */
+static int spill(_llist_sorter *sorter)
+{
+	_spill_state state = { sorter, NULL, LLIST_SUCCESS };
+	_sort_run *run;
+	int rc;
+
+	if (llist_is_empty(sorter->buffer))
+		return LLIST_SUCCESS;
+
+	if (sorter->nruns == sorter->runs_size) {
+		unsigned int size = sorter->runs_size ? sorter->runs_size * 2 : 8;
+
+		run = realloc(sorter->runs, size * sizeof(_sort_run));
+		if (run == NULL)
+			return LLIST_MALLOC_ERROR;
+
+		sorter->runs = run;
+		sorter->runs_size = size;
+	}
+
+	rc = llist_sort(sorter->buffer, sorter->flags);
+	if (rc != LLIST_SUCCESS)
+		return rc;
+
+	run = &sorter->runs[sorter->nruns];
+	run->file = tmpfile();
+	if (run->file == NULL)
+		return LLIST_ERROR;
+
+	state.file = run->file;
+	llist_for_each_until(sorter->buffer, spill_node, &state);
+	if ((state.rc == LLIST_SUCCESS) && fflush(run->file))
+		state.rc = LLIST_ERROR;
+
+	if (state.rc != LLIST_SUCCESS) {
+		fclose(run->file);
+		return state.rc;
+	}
+
+	run->current = NULL;
+	run->done = false;
+	sorter->nruns++;
+
+	llist_clear(sorter->buffer, true, sorter->destructor);
+	sorter->mem_used = 0;
+
+	return LLIST_SUCCESS;
+}
+
+static void close_runs(_llist_sorter *sorter)
+{
+	unsigned int i;
+
+	for (i = 0; i < sorter->nruns; i++) {
+		if (sorter->runs[i].current)
+			destroy_node(sorter, sorter->runs[i].current);
+
+		fclose(sorter->runs[i].file);
+	}
+
+	sorter->nruns = 0;
+}
+
+llist_sorter llist_sorter_create(comperator compare_func, int flags,
+				 size_t mem_limit, node_encoder encoder,
+				 node_decoder decoder, node_func destructor)
+{
+	_llist_sorter *sorter;
+
+	if ((compare_func == NULL) || (encoder == NULL) || (decoder == NULL))
+		return NULL;
+
+	sorter = malloc(sizeof(_llist_sorter));
+	if (sorter == NULL)
+		return NULL;
+
+	sorter->buffer = llist_create(compare_func, NULL, 0);
+	if (sorter->buffer == NULL) {
+		free(sorter);
+		return NULL;
+	}
+
+	sorter->comp_func = compare_func;
+	sorter->flags = flags;
+	sorter->mem_limit = mem_limit;
+	sorter->mem_used = 0;
+	sorter->encoder = encoder;
+	sorter->decoder = decoder;
+	sorter->destructor = destructor;
+	sorter->runs = NULL;
+	sorter->nruns = 0;
+	sorter->runs_size = 0;
+	sorter->merging = false;
+	sorter->scratch = NULL;
+	sorter->scratch_size = 0;
+
+	return sorter;
+}
+
+void llist_sorter_destroy(llist_sorter sorter, bool destroy_nodes)
+{
+	_llist_sorter *thesorter = (_llist_sorter *) sorter;
+
+	if (sorter == NULL)
+		return;
+
+	llist_destroy(thesorter->buffer, destroy_nodes, thesorter->destructor);
+	close_runs(thesorter);
+	free(thesorter->runs);
+	free(thesorter->scratch);
+	free(thesorter);
+}
+
+/*
+ * Put a node in the buffer, spilling what is there first if the node doesn't
+ * fit. The sorter only owns the node once this succeeded.
+ */
+static int buffer_node(_llist_sorter *sorter, llist_node node)
+{
+	size_t size;
+	int rc;
+
+	// the runs are being merged, see sorter_drain()
+	if (sorter->merging)
+		return LLIST_ERROR;
+
+	// account for the wrapper too, not only for the payload
+	size = sorter->encoder(node, NULL, 0) + 2 * sizeof(void *);
+
+	if ((sorter->mem_limit > 0) &&
+	    (sorter->mem_used + size > sorter->mem_limit)) {
+		rc = spill(sorter);
+		if (rc != LLIST_SUCCESS)
+			return rc;
+	}
+
+	rc = llist_add_node(sorter->buffer, node, ADD_NODE_REAR);
+	if (rc != LLIST_SUCCESS)
+		return rc;
+
+	sorter->mem_used += size;
+
+	return LLIST_SUCCESS;
+}
+
+int llist_sorter_add(llist_sorter sorter, llist_node node)
+{
+	if (sorter == NULL)
+		return LLIST_NULL_ARGUMENT;
+
+	return buffer_node(sorter, node);
+}
+
+int llist_sorter_add_list(llist_sorter sorter, llist list)
+{
+	llist_node node;
+	int rc;
+
+	if ((sorter == NULL) || (list == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	while (llist_size(list) > 0) {
+		node = llist_pop(list);
+
+		rc = buffer_node(sorter, node);
+		if (rc != LLIST_SUCCESS) {
+			// hand the node back, the caller still owns it
+			llist_push(list, node);
+			return rc;
+		}
+	}
+
+	return LLIST_SUCCESS;
+}
+
+static bool run_before(_llist_sorter *sorter, unsigned int a, unsigned int b)
+{
+	int direction = (sorter->flags & SORT_LIST_ASCENDING) ? 1 : -1;
+	int rc = direction * sorter->comp_func(sorter->runs[a].current,
+					       sorter->runs[b].current);
+
+	// equal nodes are taken from the earlier run to keep the sort stable
+	return (rc < 0) || ((rc == 0) && (a < b));
+}
+
+static void run_sift_down(_llist_sorter *sorter, unsigned int *heap,
+			  unsigned int size, unsigned int i)
+{
+	unsigned int child, temp;
+
+	while ((child = 2 * i + 1) < size) {
+		if ((child + 1 < size) &&
+		    run_before(sorter, heap[child + 1], heap[child]))
+			child++;
+
+		if (!run_before(sorter, heap[child], heap[i]))
+			break;
+
+		temp = heap[i];
+		heap[i] = heap[child];
+		heap[child] = temp;
+		i = child;
+	}
+}
+
+/*
+ * Hand every node, in order, either to out (if not NULL) or to func. If out
+ * refuses a node the merge stops there, with that node still current in its
+ * run, and the next call picks it up again.
+ */
+static int sorter_drain(_llist_sorter *sorter, llist out, node_func_arg func,
+			void *arg)
+{
+	unsigned int *heap;
+	unsigned int size, i;
+	llist_node node;
+	int rc = LLIST_SUCCESS;
+
+	// everything fit in memory, no need to touch the disk
+	if (sorter->nruns == 0) {
+		rc = llist_sort(sorter->buffer, sorter->flags);
+		if (rc != LLIST_SUCCESS)
+			return rc;
+
+		sorter->mem_used = 0;
+
+		if (out)
+			return llist_concat(out, sorter->buffer);
+
+		while (llist_size(sorter->buffer) > 0)
+			func(llist_pop(sorter->buffer), arg);
+
+		return LLIST_SUCCESS;
+	}
+
+	if (!sorter->merging) {
+		rc = spill(sorter);
+		if (rc != LLIST_SUCCESS)
+			return rc;
+
+		for (i = 0; i < sorter->nruns; i++) {
+			rewind(sorter->runs[i].file);
+
+			rc = read_record(sorter, &sorter->runs[i]);
+			if (rc != LLIST_SUCCESS) {
+				close_runs(sorter);
+				return rc;
+			}
+		}
+
+		sorter->merging = true;
+	}
+
+	heap = malloc(sorter->nruns * sizeof(unsigned int));
+	if (heap == NULL)
+		return LLIST_MALLOC_ERROR;
+
+	size = 0;
+	for (i = 0; i < sorter->nruns; i++)
+		if (!sorter->runs[i].done)
+			heap[size++] = i;
+
+	for (i = size / 2; i > 0; i--)
+		run_sift_down(sorter, heap, size, i - 1);
+
+	while (size > 0) {
+		_sort_run *run = &sorter->runs[heap[0]];
+
+		node = run->current;
+
+		if (out) {
+			rc = llist_add_node(out, node, ADD_NODE_REAR);
+			if (rc != LLIST_SUCCESS) {
+				// keep the node and the runs, it can be resumed
+				free(heap);
+				return rc;
+			}
+		} else {
+			func(node, arg);
+		}
+
+		run->current = NULL;
+		rc = read_record(sorter, run);
+		if (rc != LLIST_SUCCESS)
+			goto out;
+
+		if (run->done)
+			heap[0] = heap[--size];
+
+		run_sift_down(sorter, heap, size, 0);
+	}
+
+out:
+	free(heap);
+	close_runs(sorter);
+	sorter->merging = false;
+
+	return rc;
+}
+
+int llist_sorter_finish(llist_sorter sorter, llist out)
+{
+	if ((sorter == NULL) || (out == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	return sorter_drain((_llist_sorter *) sorter, out, NULL, NULL);
+}
+
+int llist_sorter_finish_each(llist_sorter sorter, node_func_arg func,
+			     void *arg)
+{
+	if ((sorter == NULL) || (func == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	return sorter_drain((_llist_sorter *) sorter, NULL, func, arg);
+}
@@ -0,0 +1,1119 @@
+/*
+ *    Copyright [2013] [Ramon Fried] <ramon.fried at gmail dot com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Typed-key lists: an unrolled linked list of blocks, every block holds up
+ * to KEYED_BLOCK_NODES nodes and their keys in two parallel arrays. Keeping
+ * the keys contiguous lets find/count/min/max run SIMD kernels over them
+ * instead of calling a comparator per node. The kernels are picked once at
+ * creation time according to what the CPU supports.
+ */
+
+#include "../inc/llist.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KEYED_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#define KEYED_BLOCK_NODES 64
+
+typedef struct __key_block {
+	struct __key_block *next;
+	unsigned int start;     // occupied slots are [start, end)
+	unsigned int end;
+	llist_node nodes[KEYED_BLOCK_NODES];
+	int64_t keys[];         // KEYED_BLOCK_NODES keys of key_len bytes
+} _key_block;
+
+/*
+ * Kernels work on n contiguous keys and return the index of the first
+ * matching / extreme key, or -1.
+ */
+typedef struct {
+	int (*find)(const void *keys, unsigned int n, const void *key,
+		    size_t key_len);
+	unsigned int (*count)(const void *keys, unsigned int n,
+			      const void *key, size_t key_len);
+	int (*min)(const void *keys, unsigned int n, size_t key_len);
+	int (*max)(const void *keys, unsigned int n, size_t key_len);
+} _key_kernels;
+
+typedef struct {
+	unsigned int count;
+	E_LLIST_KEY key_type;
+	size_t key_len;
+	const _key_kernels *kernels;
+	_key_block *head;
+	_key_block *tail;
+
+	//multi-threading support
+	unsigned char ismt;
+	pthread_rwlock_t llist_lock;
+} _llist_keyed;
+
+static inline int write_lock(_llist_keyed *list)
+{
+	int rc = 0;
+
+	if (list->ismt)
+		rc = pthread_rwlock_wrlock(&list->llist_lock);
+
+	return rc;
+}
+
+static inline int read_lock(_llist_keyed *list)
+{
+	int rc = 0;
+
+	if (list->ismt)
+		rc = pthread_rwlock_rdlock(&list->llist_lock);
+
+	return rc;
+}
+
+static inline void unlock(_llist_keyed *list)
+{
+	if (list->ismt)
+		pthread_rwlock_unlock(&list->llist_lock);
+}
+
+static inline void *block_key(_llist_keyed *list, _key_block *block,
+			      unsigned int i)
+{
+	return (unsigned char *) block->keys + i * list->key_len;
+}
+
+static inline _key_block *alloc_block(_llist_keyed *list)
+{
+	return malloc(sizeof(_key_block) + KEYED_BLOCK_NODES * list->key_len);
+}
+
+/* Scalar kernels, always available */
+
+static int find_i64_scalar(const void *keys, unsigned int n, const void *key,
+			   size_t key_len)
+{
+	const int64_t *k = keys;
+	int64_t value;
+	unsigned int i;
+
+	memcpy(&value, key, sizeof(value));
+
+	for (i = 0; i < n; i++)
+		if (k[i] == value)
+			return i;
+
+	return -1;
+}
+
+static unsigned int count_i64_scalar(const void *keys, unsigned int n,
+				     const void *key, size_t key_len)
+{
+	const int64_t *k = keys;
+	unsigned int i, count = 0;
+	int64_t value;
+
+	memcpy(&value, key, sizeof(value));
+
+	for (i = 0; i < n; i++)
+		count += (k[i] == value);
+
+	return count;
+}
+
+static int min_i64_scalar(const void *keys, unsigned int n, size_t key_len)
+{
+	const int64_t *k = keys;
+	unsigned int i, best = 0;
+
+	for (i = 1; i < n; i++)
+		if (k[i] < k[best])
+			best = i;
+
+	return n ? (int) best : -1;
+}
+
+static int max_i64_scalar(const void *keys, unsigned int n, size_t key_len)
+{
+	const int64_t *k = keys;
+	unsigned int i, best = 0;
+
+	for (i = 1; i < n; i++)
+		if (k[i] > k[best])
+			best = i;
+
+	return n ? (int) best : -1;
+}
+
+static int find_double_scalar(const void *keys, unsigned int n,
+			      const void *key, size_t key_len)
+{
+	const double *k = keys;
+	unsigned int i;
+	double value;
+
+	memcpy(&value, key, sizeof(value));
+
+	for (i = 0; i < n; i++)
+		if (k[i] == value)
+			return i;
+
+	return -1;
+}
+
+static unsigned int count_double_scalar(const void *keys, unsigned int n,
+					const void *key, size_t key_len)
+{
+	const double *k = keys;
+	unsigned int i, count = 0;
+	double value;
+
+	memcpy(&value, key, sizeof(value));
+
+	for (i = 0; i < n; i++)
+		count += (k[i] == value);
+
+	return count;
+}
+
+static int min_double_scalar(const void *keys, unsigned int n, size_t key_len)
+{
+	const double *k = keys;
+	unsigned int i, best = 0;
+
+	for (i = 1; i < n; i++)
+		if (k[i] < k[best])
+			best = i;
+
+	return n ? (int) best : -1;
+}
+
+static int max_double_scalar(const void *keys, unsigned int n, size_t key_len)
+{
+	const double *k = keys;
+	unsigned int i, best = 0;
+
+	for (i = 1; i < n; i++)
+		if (k[i] > k[best])
+			best = i;
+
+	return n ? (int) best : -1;
+}
+
+static int find_bytes(const void *keys, unsigned int n, const void *key,
+		      size_t key_len)
+{
+	const unsigned char *k = keys;
+	unsigned int i;
+
+	for (i = 0; i < n; i++)
+		if (memcmp(k + i * key_len, key, key_len) == 0)
+			return i;
+
+	return -1;
+}
+
+static unsigned int count_bytes(const void *keys, unsigned int n,
+				const void *key, size_t key_len)
+{
+	const unsigned char *k = keys;
+	unsigned int i, count = 0;
+
+	for (i = 0; i < n; i++)
+		count += (memcmp(k + i * key_len, key, key_len) == 0);
+
+	return count;
+}
+
+static int min_bytes(const void *keys, unsigned int n, size_t key_len)
+{
+	const unsigned char *k = keys;
+	unsigned int i, best = 0;
+
+	for (i = 1; i < n; i++)
+		if (memcmp(k + i * key_len, k + best * key_len, key_len) < 0)
+			best = i;
+
+	return n ? (int) best : -1;
+}
+
+static int max_bytes(const void *keys, unsigned int n, size_t key_len)
+{
+	const unsigned char *k = keys;
+	unsigned int i, best = 0;
+
+	for (i = 1; i < n; i++)
+		if (memcmp(k + i * key_len, k + best * key_len, key_len) > 0)
+			best = i;
+
+	return n ? (int) best : -1;
+}
+
+static const _key_kernels i64_scalar_kernels = {
+	find_i64_scalar, count_i64_scalar, min_i64_scalar, max_i64_scalar
+};
+
+static const _key_kernels double_scalar_kernels = {
+	find_double_scalar, count_double_scalar, min_double_scalar,
+	max_double_scalar
+};
+
+static const _key_kernels bytes_kernels = {
+	find_bytes, count_bytes, min_bytes, max_bytes
+};
+
+#ifdef KEYED_X86_KERNELS
+
+/*
+ * The min/max kernels first reduce the extreme value with vector min/max,
+ * then locate its first occurrence with the find kernel, so ties resolve to
+ * the first node exactly like the scalar kernels.
+ */
+
+/* AVX2 kernels, 4 keys per iteration */
+
+__attribute__((target("avx2")))
+static int find_i64_avx2(const void *keys, unsigned int n, const void *key,
+			 size_t key_len)
+{
+	const int64_t *k = keys;
+	unsigned int i = 0;
+	int64_t value;
+	__m256i needle;
+	int mask;
+
+	memcpy(&value, key, sizeof(value));
+	needle = _mm256_set1_epi64x(value);
+
+	for (; i + 4 <= n; i += 4) {
+		__m256i cur = _mm256_loadu_si256((const __m256i *)(k + i));
+
+		mask = _mm256_movemask_pd(_mm256_castsi256_pd(
+						  _mm256_cmpeq_epi64(cur, needle)));
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+
+	for (; i < n; i++)
+		if (k[i] == value)
+			return i;
+
+	return -1;
+}
+
+__attribute__((target("avx2")))
+static unsigned int count_i64_avx2(const void *keys, unsigned int n,
+				   const void *key, size_t key_len)
+{
+	const int64_t *k = keys;
+	unsigned int i = 0, count = 0;
+	int64_t value;
+	__m256i needle;
+
+	memcpy(&value, key, sizeof(value));
+	needle = _mm256_set1_epi64x(value);
+
+	for (; i + 4 <= n; i += 4) {
+		__m256i cur = _mm256_loadu_si256((const __m256i *)(k + i));
+
+		count += __builtin_popcount(_mm256_movemask_pd(
+						    _mm256_castsi256_pd(_mm256_cmpeq_epi64(cur, needle))));
+	}
+
+	for (; i < n; i++)
+		count += (k[i] == value);
+
+	return count;
+}
+
+__attribute__((target("avx2")))
+static int extreme_i64_avx2(const void *keys, unsigned int n, bool max)
+{
+	const int64_t *k = keys;
+	unsigned int i = 0;
+	int64_t lanes[4], best;
+	__m256i acc;
+
+	if (n == 0)
+		return -1;
+
+	best = k[0];
+	acc = _mm256_set1_epi64x(best);
+
+	for (; i + 4 <= n; i += 4) {
+		__m256i cur = _mm256_loadu_si256((const __m256i *)(k + i));
+		__m256i take = max ? _mm256_cmpgt_epi64(cur, acc) :
+			       _mm256_cmpgt_epi64(acc, cur);
+
+		acc = _mm256_blendv_epi8(acc, cur, take);
+	}
+
+	_mm256_storeu_si256((__m256i *) lanes, acc);
+	for (unsigned int j = 0; j < 4; j++)
+		if (max ? (lanes[j] > best) : (lanes[j] < best))
+			best = lanes[j];
+
+	for (; i < n; i++)
+		if (max ? (k[i] > best) : (k[i] < best))
+			best = k[i];
+
+	return find_i64_avx2(keys, n, &best, sizeof(best));
+}
+
+static int min_i64_avx2(const void *keys, unsigned int n, size_t key_len)
+{
+	return extreme_i64_avx2(keys, n, false);
+}
+
+static int max_i64_avx2(const void *keys, unsigned int n, size_t key_len)
+{
+	return extreme_i64_avx2(keys, n, true);
+}
+
+__attribute__((target("avx2")))
+static int find_double_avx2(const void *keys, unsigned int n, const void *key,
+			    size_t key_len)
+{
+	const double *k = keys;
+	unsigned int i = 0;
+	double value;
+	__m256d needle;
+	int mask;
+
+	memcpy(&value, key, sizeof(value));
+	needle = _mm256_set1_pd(value);
+
+	for (; i + 4 <= n; i += 4) {
+		mask = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(k + i),
+							needle, _CMP_EQ_OQ));
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+
+	for (; i < n; i++)
+		if (k[i] == value)
+			return i;
+
+	return -1;
+}
+
+__attribute__((target("avx2")))
+static unsigned int count_double_avx2(const void *keys, unsigned int n,
+				      const void *key, size_t key_len)
+{
+	const double *k = keys;
+	unsigned int i = 0, count = 0;
+	double value;
+	__m256d needle;
+
+	memcpy(&value, key, sizeof(value));
+	needle = _mm256_set1_pd(value);
+
+	for (; i + 4 <= n; i += 4)
+		count += __builtin_popcount(_mm256_movemask_pd(
+						    _mm256_cmp_pd(_mm256_loadu_pd(k + i), needle,
+								    _CMP_EQ_OQ)));
+
+	for (; i < n; i++)
+		count += (k[i] == value);
+
+	return count;
+}
+
+__attribute__((target("avx2")))
+static int extreme_double_avx2(const void *keys, unsigned int n, bool max)
+{
+	const double *k = keys;
+	unsigned int i = 0;
+	double lanes[4], best;
+	__m256d acc;
+
+	if (n == 0)
+		return -1;
+
+	best = k[0];
+	acc = _mm256_set1_pd(best);
+
+	for (; i + 4 <= n; i += 4) {
+		__m256d cur = _mm256_loadu_pd(k + i);
+
+		acc = max ? _mm256_max_pd(acc, cur) : _mm256_min_pd(acc, cur);
+	}
+
+	_mm256_storeu_pd(lanes, acc);
+	for (unsigned int j = 0; j < 4; j++)
+		if (max ? (lanes[j] > best) : (lanes[j] < best))
+			best = lanes[j];
+
+	for (; i < n; i++)
+		if (max ? (k[i] > best) : (k[i] < best))
+			best = k[i];
+
+	return find_double_avx2(keys, n, &best, sizeof(best));
+}
+
+static int min_double_avx2(const void *keys, unsigned int n, size_t key_len)
+{
+	return extreme_double_avx2(keys, n, false);
+}
+
+static int max_double_avx2(const void *keys, unsigned int n, size_t key_len)
+{
+	return extreme_double_avx2(keys, n, true);
+}
+
+/* SSE kernels, 2 keys per iteration (SSE4.2 for int64, SSE2 for double) */
+
+__attribute__((target("sse4.2")))
+static int find_i64_sse(const void *keys, unsigned int n, const void *key,
+			size_t key_len)
+{
+	const int64_t *k = keys;
+	unsigned int i = 0;
+	int64_t value;
+	__m128i needle;
+	int mask;
+
+	memcpy(&value, key, sizeof(value));
+	needle = _mm_set1_epi64x(value);
+
+	for (; i + 2 <= n; i += 2) {
+		__m128i cur = _mm_loadu_si128((const __m128i *)(k + i));
+
+		mask = _mm_movemask_pd(_mm_castsi128_pd(
+					       _mm_cmpeq_epi64(cur, needle)));
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+
+	for (; i < n; i++)
+		if (k[i] == value)
+			return i;
+
+	return -1;
+}
+
+__attribute__((target("sse4.2")))
+static unsigned int count_i64_sse(const void *keys, unsigned int n,
+				  const void *key, size_t key_len)
+{
+	const int64_t *k = keys;
+	unsigned int i = 0, count = 0;
+	int64_t value;
+	__m128i needle;
+
+	memcpy(&value, key, sizeof(value));
+	needle = _mm_set1_epi64x(value);
+
+	for (; i + 2 <= n; i += 2) {
+		__m128i cur = _mm_loadu_si128((const __m128i *)(k + i));
+
+		count += __builtin_popcount(_mm_movemask_pd(
+						    _mm_castsi128_pd(_mm_cmpeq_epi64(cur, needle))));
+	}
+
+	for (; i < n; i++)
+		count += (k[i] == value);
+
+	return count;
+}
+
+__attribute__((target("sse4.2")))
+static int extreme_i64_sse(const void *keys, unsigned int n, bool max)
+{
+	const int64_t *k = keys;
+	unsigned int i = 0;
+	int64_t lanes[2], best;
+	__m128i acc;
+
+	if (n == 0)
+		return -1;
+
+	best = k[0];
+	acc = _mm_set1_epi64x(best);
+
+	for (; i + 2 <= n; i += 2) {
+		__m128i cur = _mm_loadu_si128((const __m128i *)(k + i));
+		__m128i take = max ? _mm_cmpgt_epi64(cur, acc) :
+			       _mm_cmpgt_epi64(acc, cur);
+
+		acc = _mm_blendv_epi8(acc, cur, take);
+	}
+
+	_mm_storeu_si128((__m128i *) lanes, acc);
+	for (unsigned int j = 0; j < 2; j++)
+		if (max ? (lanes[j] > best) : (lanes[j] < best))
+			best = lanes[j];
+
+	for (; i < n; i++)
+		if (max ? (k[i] > best) : (k[i] < best))
+			best = k[i];
+
+	return find_i64_sse(keys, n, &best, sizeof(best));
+}
+
+static int min_i64_sse(const void *keys, unsigned int n, size_t key_len)
+{
+	return extreme_i64_sse(keys, n, false);
+}
+
+static int max_i64_sse(const void *keys, unsigned int n, size_t key_len)
+{
+	return extreme_i64_sse(keys, n, true);
+}
+
+__attribute__((target("sse2")))
+static int find_double_sse(const void *keys, unsigned int n, const void *key,
+			   size_t key_len)
+{
+	const double *k = keys;
+	unsigned int i = 0;
+	double value;
+	__m128d needle;
+	int mask;
+
+	memcpy(&value, key, sizeof(value));
+	needle = _mm_set1_pd(value);
+
+	for (; i + 2 <= n; i += 2) {
+		mask = _mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(k + i), needle));
+		if (mask)
+			return i + __builtin_ctz(mask);
+	}
+
+	for (; i < n; i++)
+		if (k[i] == value)
+			return i;
+
+	return -1;
+}
+
+__attribute__((target("sse2")))
+static unsigned int count_double_sse(const void *keys, unsigned int n,
+				     const void *key, size_t key_len)
+{
+	const double *k = keys;
+	unsigned int i = 0, count = 0;
+	double value;
+	__m128d needle;
+
+	memcpy(&value, key, sizeof(value));
+	needle = _mm_set1_pd(value);
+
+	for (; i + 2 <= n; i += 2)
+		count += __builtin_popcount(_mm_movemask_pd(
+						    _mm_cmpeq_pd(_mm_loadu_pd(k + i), needle)));
+
+	for (; i < n; i++)
+		count += (k[i] == value);
+
+	return count;
+}
+
+__attribute__((target("sse2")))
+static int extreme_double_sse(const void *keys, unsigned int n, bool max)
+{
+	const double *k = keys;
+	unsigned int i = 0;
+	double lanes[2], best;
+	__m128d acc;
+
+	if (n == 0)
+		return -1;
+
+	best = k[0];
+	acc = _mm_set1_pd(best);
+
+	for (; i + 2 <= n; i += 2) {
+		__m128d cur = _mm_loadu_pd(k + i);
+
+		acc = max ? _mm_max_pd(acc, cur) : _mm_min_pd(acc, cur);
+	}
+
+	_mm_storeu_pd(lanes, acc);
+	for (unsigned int j = 0; j < 2; j++)
+		if (max ? (lanes[j] > best) : (lanes[j] < best))
+			best = lanes[j];
+
+	for (; i < n; i++)
+		if (max ? (k[i] > best) : (k[i] < best))
+			best = k[i];
+
+	return find_double_sse(keys, n, &best, sizeof(best));
+}
+
+static int min_double_sse(const void *keys, unsigned int n, size_t key_len)
+{
+	return extreme_double_sse(keys, n, false);
+}
+
+static int max_double_sse(const void *keys, unsigned int n, size_t key_len)
+{
+	return extreme_double_sse(keys, n, true);
+}
+
+static const _key_kernels i64_avx2_kernels = {
+	find_i64_avx2, count_i64_avx2, min_i64_avx2, max_i64_avx2
+};
+
+static const _key_kernels double_avx2_kernels = {
+	find_double_avx2, count_double_avx2, min_double_avx2, max_double_avx2
+};
+
+static const _key_kernels i64_sse_kernels = {
+	find_i64_sse, count_i64_sse, min_i64_sse, max_i64_sse
+};
+
+static const _key_kernels double_sse_kernels = {
+	find_double_sse, count_double_sse, min_double_sse, max_double_sse
+};
+
+#endif /* KEYED_X86_KERNELS */
+
+static const _key_kernels *select_kernels(E_LLIST_KEY key_type,
+		unsigned int flags)
+{
+	if (key_type == LLIST_KEY_BYTES)
+		return &bytes_kernels;
+
+#ifdef KEYED_X86_KERNELS
+	if (!(flags & FLAG_NO_SIMD)) {
+		__builtin_cpu_init();
+
+		if (__builtin_cpu_supports("avx2"))
+			return (key_type == LLIST_KEY_INT64) ?
+			       &i64_avx2_kernels : &double_avx2_kernels;
+
+		if ((key_type == LLIST_KEY_DOUBLE) &&
+		    __builtin_cpu_supports("sse2"))
+			return &double_sse_kernels;
+
+		if ((key_type == LLIST_KEY_INT64) &&
+		    __builtin_cpu_supports("sse4.2"))
+			return &i64_sse_kernels;
+	}
+#endif
+
+	return (key_type == LLIST_KEY_INT64) ?
+	       &i64_scalar_kernels : &double_scalar_kernels;
+}
+
+// Scalar key comparison, used to combine the per block kernel results
+static int key_compare(_llist_keyed *list, const void *a, const void *b)
+{
+	switch (list->key_type) {
+	case LLIST_KEY_INT64: {
+		int64_t x, y;
+
+		memcpy(&x, a, sizeof(x));
+		memcpy(&y, b, sizeof(y));
+		return (x > y) - (x < y);
+	}
+	case LLIST_KEY_DOUBLE: {
+		double x, y;
+
+		memcpy(&x, a, sizeof(x));
+		memcpy(&y, b, sizeof(y));
+		return (x > y) - (x < y);
+	}
+	default:
+		return memcmp(a, b, list->key_len);
+	}
+}
+
+llist_keyed llist_keyed_create(E_LLIST_KEY key_type, size_t key_len,
+			       unsigned int flags)
+{
+	_llist_keyed *new_list;
+
+	switch (key_type) {
+	case LLIST_KEY_INT64:
+		key_len = sizeof(int64_t);
+		break;
+	case LLIST_KEY_DOUBLE:
+		key_len = sizeof(double);
+		break;
+	case LLIST_KEY_BYTES:
+		if (key_len == 0)
+			return NULL;
+		break;
+	default:
+		return NULL;
+	}
+
+	new_list = malloc(sizeof(_llist_keyed));
+	if (new_list == NULL)
+		return NULL;
+
+	new_list->count = 0;
+	new_list->key_type = key_type;
+	new_list->key_len = key_len;
+	new_list->kernels = select_kernels(key_type, flags);
+	new_list->head = NULL;
+	new_list->tail = NULL;
+
+	new_list->ismt = false;
+	if (flags & FLAG_MT_SUPPORT) {
+		new_list->ismt = true;
+		if (pthread_rwlock_init(&new_list->llist_lock, NULL) != 0) {
+			free(new_list);
+			return NULL;
+		}
+	}
+
+	return new_list;
+}
+
+void llist_keyed_destroy(llist_keyed list, bool destroy_nodes,
+			 node_func destructor)
+{
+	_llist_keyed *thelist = (_llist_keyed *) list;
+	_key_block *block, *next;
+	unsigned int i;
+
+	if (list == NULL)
+		return;
+
+	block = thelist->head;
+	while (block) {
+		if (destroy_nodes) {
+			for (i = block->start; i < block->end; i++) {
+				if (destructor)
+					destructor(block->nodes[i]);
+				else
+					free(block->nodes[i]);
+			}
+		}
+
+		next = block->next;
+		free(block);
+		block = next;
+	}
+
+	if (thelist->ismt)
+		pthread_rwlock_destroy(&thelist->llist_lock);
+
+	free(list);
+}
+
+int llist_keyed_add_node(llist_keyed list, const void *key, llist_node node,
+			 int flags)
+{
+	_llist_keyed *thelist = (_llist_keyed *) list;
+	_key_block *block;
+	unsigned int slot;
+
+	if ((list == NULL) || (key == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (write_lock(thelist))
+		return LLIST_MULTITHREAD_ISSUE;
+
+	if (flags & ADD_NODE_FRONT) {
+		block = thelist->head;
+		if ((block == NULL) || (block->start == 0)) {
+			// a new front block fills up from its end
+			block = alloc_block(thelist);
+			if (block == NULL) {
+				unlock(thelist);
+				return LLIST_MALLOC_ERROR;
+			}
+
+			block->start = block->end = KEYED_BLOCK_NODES;
+			block->next = thelist->head;
+			thelist->head = block;
+			if (thelist->tail == NULL)
+				thelist->tail = block;
+		}
+		slot = --block->start;
+	} else {
+		block = thelist->tail;
+		if ((block == NULL) || (block->end == KEYED_BLOCK_NODES)) {
+			block = alloc_block(thelist);
+			if (block == NULL) {
+				unlock(thelist);
+				return LLIST_MALLOC_ERROR;
+			}
+
+			block->start = block->end = 0;
+			block->next = NULL;
+			if (thelist->tail)
+				thelist->tail->next = block;
+			else
+				thelist->head = block;
+			thelist->tail = block;
+		}
+		slot = block->end++;
+	}
+
+	block->nodes[slot] = node;
+	memcpy(block_key(thelist, block, slot), key, thelist->key_len);
+	thelist->count++;
+
+	unlock(thelist);
+
+	return LLIST_SUCCESS;
+}
+
+/*
+ * Move the nodes of second (the block after first) to the end of first and
+ * unlink second, the caller frees it.
+ */
+static void merge_blocks(_llist_keyed *list, _key_block *first,
+			 _key_block *second)
+{
+	unsigned int n = first->end - first->start;
+	unsigned int m = second->end - second->start;
+
+	memmove(&first->nodes[0], &first->nodes[first->start],
+		n * sizeof(llist_node));
+	memmove(block_key(list, first, 0), block_key(list, first, first->start),
+		n * list->key_len);
+	memcpy(&first->nodes[n], &second->nodes[second->start],
+	       m * sizeof(llist_node));
+	memcpy(block_key(list, first, n), block_key(list, second, second->start),
+	       m * list->key_len);
+
+	first->start = 0;
+	first->end = n + m;
+	first->next = second->next;
+	if (list->tail == second)
+		list->tail = first;
+}
+
+static inline bool blocks_fit(_key_block *first, _key_block *second)
+{
+	return (first->end - first->start) + (second->end - second->start) <=
+	       KEYED_BLOCK_NODES;
+}
+
+int llist_keyed_delete_node(llist_keyed list, const void *key,
+			    bool destroy_node, node_func destructor)
+{
+	_llist_keyed *thelist = (_llist_keyed *) list;
+	_key_block *block, *prev = NULL;
+	llist_node node;
+	unsigned int slot;
+	int i;
+
+	if ((list == NULL) || (key == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (write_lock(thelist))
+		return LLIST_MULTITHREAD_ISSUE;
+
+	for (block = thelist->head; block; prev = block, block = block->next) {
+		i = thelist->kernels->find(block_key(thelist, block, block->start),
+					   block->end - block->start, key,
+					   thelist->key_len);
+		if (i >= 0)
+			break;
+	}
+
+	if (block == NULL) {
+		unlock(thelist);
+		return LLIST_NODE_NOT_FOUND;
+	}
+
+	slot = block->start + i;
+	node = block->nodes[slot];
+
+	// close the gap, keeping the block contiguous
+	memmove(&block->nodes[slot], &block->nodes[slot + 1],
+		(block->end - slot - 1) * sizeof(llist_node));
+	memmove(block_key(thelist, block, slot),
+		block_key(thelist, block, slot + 1),
+		(block->end - slot - 1) * thelist->key_len);
+	block->end--;
+	thelist->count--;
+
+	if (block->start == block->end) {
+		if (prev)
+			prev->next = block->next;
+		else
+			thelist->head = block->next;
+
+		if (thelist->tail == block)
+			thelist->tail = prev;
+	} else if (block->end - block->start < KEYED_BLOCK_NODES / 2) {
+		// fold sparse blocks into a neighbour, the kernels scan less
+		if (block->next && blocks_fit(block, block->next)) {
+			prev = block;
+			block = block->next;
+			merge_blocks(thelist, prev, block);
+		} else if (prev && blocks_fit(prev, block)) {
+			merge_blocks(thelist, prev, block);
+		} else {
+			block = NULL;
+		}
+	} else {
+		block = NULL;
+	}
+
+	unlock(thelist);
+
+	free(block);
+
+	if (destroy_node) {
+		if (destructor)
+			destructor(node);
+		else
+			free(node);
+	}
+
+	return LLIST_SUCCESS;
+}
+
+int llist_keyed_find_node(llist_keyed list, const void *key,
+			  llist_node *found)
+{
+	_llist_keyed *thelist = (_llist_keyed *) list;
+	_key_block *block;
+	int i;
+
+	if ((list == NULL) || (key == NULL) || (found == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	read_lock(thelist);
+
+	for (block = thelist->head; block; block = block->next) {
+		i = thelist->kernels->find(block_key(thelist, block, block->start),
+					   block->end - block->start, key,
+					   thelist->key_len);
+		if (i >= 0) {
+			*found = block->nodes[block->start + i];
+			unlock(thelist);
+			return LLIST_SUCCESS;
+		}
+	}
+
+	unlock(thelist);
+
+	return LLIST_NODE_NOT_FOUND;
+}
+
+int llist_keyed_count(llist_keyed list, const void *key)
+{
+	_llist_keyed *thelist = (_llist_keyed *) list;
+	_key_block *block;
+	unsigned int count = 0;
+
+	if ((list == NULL) || (key == NULL))
+		return 0;
+
+	read_lock(thelist);
+
+	for (block = thelist->head; block; block = block->next)
+		count += thelist->kernels->count(block_key(thelist, block,
+						 block->start),
+						 block->end - block->start,
+						 key, thelist->key_len);
+
+	unlock(thelist);
+
+	return count;
+}
+
+static int llist_keyed_get_min_max(llist_keyed list, llist_node *output,
+				   bool max)
+{
+	_llist_keyed *thelist = (_llist_keyed *) list;
+	_key_block *block;
+	void *best = NULL, *candidate;
+	int i, rc;
+
+	if ((list == NULL) || (output == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	read_lock(thelist);
+
+	for (block = thelist->head; block; block = block->next) {
+		void *keys = block_key(thelist, block, block->start);
+		unsigned int n = block->end - block->start;
+
+		i = max ? thelist->kernels->max(keys, n, thelist->key_len) :
+		    thelist->kernels->min(keys, n, thelist->key_len);
+		if (i < 0)
+			continue;
+
+		candidate = block_key(thelist, block, block->start + i);
+		if (best) {
+			rc = key_compare(thelist, candidate, best);
+			if (max ? (rc <= 0) : (rc >= 0))
+				continue;
+		}
+
+		best = candidate;
+		*output = block->nodes[block->start + i];
+	}
+
+	unlock(thelist);
+
+	return best ? LLIST_SUCCESS : LLIST_NODE_NOT_FOUND;
+}
+
+int llist_keyed_get_max(llist_keyed list, llist_node *max)
+{
+	return llist_keyed_get_min_max(list, max, true);
+}
+
+int llist_keyed_get_min(llist_keyed list, llist_node *min)
+{
+	return llist_keyed_get_min_max(list, min, false);
+}
+
+int llist_keyed_size(llist_keyed list)
+{
+	unsigned int retval;
+
+	if (list == NULL)
+		return 0;
+
+	if (read_lock((_llist_keyed *) list))
+		return LLIST_MULTITHREAD_ISSUE;
+
+	retval = ((_llist_keyed *) list)->count;
+
+	unlock((_llist_keyed *) list);
+
+	return retval;
+}
+
+int llist_keyed_for_each(llist_keyed list, node_func func)
+{
+	_llist_keyed *thelist = (_llist_keyed *) list;
+	_key_block *block;
+	unsigned int i;
+
+	if ((list == NULL) || (func == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	read_lock(thelist);
+
+	for (block = thelist->head; block; block = block->next)
+		for (i = block->start; i < block->end; i++)
+			func(block->nodes[i]);
+
+	unlock(thelist);
+
+	return LLIST_SUCCESS;
+}
@@ -0,0 +1,461 @@
+/*
+ *    Copyright [2013] [Ramon Fried] <ramon.fried at gmail dot com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Persistent lists: the whole list, header and records, lives in a file
+ * mapped with mmap. Links are offsets from the start of the file, so the
+ * mapping address doesn't matter and opening an existing list is just a
+ * matter of mapping it again.
+ *
+ * File layout: a _pllist_header at offset 0, followed by records. Space is
+ * handed out from the end of the used area (the file grows by doubling),
+ * popped records are kept on a free list and reused when a new node fits.
+ * Offset 0 is never a record, it stands for "none".
+ */
+
+#include "../inc/llist.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define PLLIST_MAGIC "LLISTPM"
+#define PLLIST_VERSION 1
+#define PLLIST_INITIAL_SIZE 4096
+#define PLLIST_ALIGN 8
+
+// free records looked at before giving up and taking fresh space
+#define PLLIST_FREE_SCAN 8
+
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+	uint64_t used;          // bytes of the file in use
+	uint64_t head;
+	uint64_t tail;
+	uint64_t count;
+	uint64_t free;          // popped records, linked through next
+} _pllist_header;
+
+typedef struct {
+	uint64_t next;
+	uint64_t capacity;      // payload bytes available
+	uint64_t len;           // payload bytes in use
+	unsigned char data[];
+} _pllist_record;
+
+typedef struct {
+	int fd;
+	unsigned char *base;
+	size_t size;            // mapped bytes, the size of the file
+
+	//multi-threading support
+	unsigned char ismt;
+	pthread_rwlock_t llist_lock;
+} _pllist;
+
+static inline int write_lock(_pllist *list)
+{
+	int rc = 0;
+
+	if (list->ismt)
+		rc = pthread_rwlock_wrlock(&list->llist_lock);
+
+	return rc;
+}
+
+static inline int read_lock(_pllist *list)
+{
+	int rc = 0;
+
+	if (list->ismt)
+		rc = pthread_rwlock_rdlock(&list->llist_lock);
+
+	return rc;
+}
+
+static inline void unlock(_pllist *list)
+{
+	if (list->ismt)
+		pthread_rwlock_unlock(&list->llist_lock);
+}
+
+static inline _pllist_header *header(_pllist *list)
+{
+	return (_pllist_header *) list->base;
+}
+
+static inline _pllist_record *record(_pllist *list, uint64_t offset)
+{
+	return (_pllist_record *) (list->base + offset);
+}
+
+// Grow the file and the mapping so that at least size bytes are usable
+static int grow(_pllist *list, uint64_t size)
+{
+	uint64_t new_size = list->size;
+	void *base;
+
+	while (new_size < size)
+		new_size *= 2;
+
+	if (ftruncate(list->fd, new_size))
+		return LLIST_ERROR;
+
+	base = mmap(NULL, new_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		    list->fd, 0);
+	if (base == MAP_FAILED)
+		return LLIST_MALLOC_ERROR;
+
+	munmap(list->base, list->size);
+	list->base = base;
+	list->size = new_size;
+
+	return LLIST_SUCCESS;
+}
+
+// Find room for a record holding len payload bytes, returns its offset or 0
+static uint64_t alloc_record(_pllist *list, uint64_t len)
+{
+	_pllist_header *hdr = header(list);
+	uint64_t *link = &hdr->free;
+	uint64_t offset, size;
+	unsigned int i;
+
+	for (i = 0; (i < PLLIST_FREE_SCAN) && *link; i++) {
+		offset = *link;
+		if (record(list, offset)->capacity >= len) {
+			*link = record(list, offset)->next;
+			return offset;
+		}
+		link = &record(list, offset)->next;
+	}
+
+	size = (sizeof(_pllist_record) + len + PLLIST_ALIGN - 1) &
+	       ~(uint64_t) (PLLIST_ALIGN - 1);
+
+	if ((hdr->used + size > list->size) &&
+	    (grow(list, hdr->used + size) != LLIST_SUCCESS))
+		return 0;
+
+	// the mapping may have moved
+	hdr = header(list);
+	offset = hdr->used;
+	hdr->used += size;
+	record(list, offset)->capacity = size - sizeof(_pllist_record);
+
+	return offset;
+}
+
+static void free_record(_pllist *list, uint64_t offset)
+{
+	record(list, offset)->next = header(list)->free;
+	header(list)->free = offset;
+}
+
+pllist pllist_open(const char *path, unsigned int flags)
+{
+	_pllist *new_list;
+	_pllist_header *hdr;
+	struct stat st;
+
+	if (path == NULL)
+		return NULL;
+
+	new_list = malloc(sizeof(_pllist));
+	if (new_list == NULL)
+		return NULL;
+
+	new_list->fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (new_list->fd < 0)
+		goto free_list;
+
+	if (fstat(new_list->fd, &st))
+		goto close_file;
+
+	new_list->size = st.st_size;
+	if ((new_list->size == 0) &&
+	    ftruncate(new_list->fd, PLLIST_INITIAL_SIZE) == 0)
+		new_list->size = PLLIST_INITIAL_SIZE;
+	else if (new_list->size < sizeof(_pllist_header))
+		goto close_file;
+
+	new_list->base = mmap(NULL, new_list->size, PROT_READ | PROT_WRITE,
+			      MAP_SHARED, new_list->fd, 0);
+	if (new_list->base == MAP_FAILED)
+		goto close_file;
+
+	hdr = header(new_list);
+	if (st.st_size == 0) {
+		// brand new file, ftruncate() zeroed it
+		memcpy(hdr->magic, PLLIST_MAGIC, sizeof(hdr->magic));
+		hdr->version = PLLIST_VERSION;
+		hdr->used = (sizeof(_pllist_header) + PLLIST_ALIGN - 1) &
+			    ~(uint64_t) (PLLIST_ALIGN - 1);
+	} else if (memcmp(hdr->magic, PLLIST_MAGIC, sizeof(hdr->magic)) ||
+		   (hdr->version != PLLIST_VERSION) ||
+		   (hdr->used > new_list->size)) {
+		goto unmap;
+	}
+
+	new_list->ismt = false;
+	if (flags & FLAG_MT_SUPPORT) {
+		if (pthread_rwlock_init(&new_list->llist_lock, NULL) != 0)
+			goto unmap;
+
+		new_list->ismt = true;
+	}
+
+	return new_list;
+
+unmap:
+	munmap(new_list->base, new_list->size);
+close_file:
+	close(new_list->fd);
+free_list:
+	free(new_list);
+
+	return NULL;
+}
+
+int pllist_close(pllist list)
+{
+	_pllist *thelist = (_pllist *) list;
+	int rc = LLIST_SUCCESS;
+
+	if (list == NULL)
+		return LLIST_NULL_ARGUMENT;
+
+	if (msync(thelist->base, thelist->size, MS_SYNC))
+		rc = LLIST_ERROR;
+
+	munmap(thelist->base, thelist->size);
+	close(thelist->fd);
+
+	if (thelist->ismt)
+		pthread_rwlock_destroy(&thelist->llist_lock);
+
+	free(thelist);
+
+	return rc;
+}
+
+int pllist_sync(pllist list)
+{
+	_pllist *thelist = (_pllist *) list;
+	int rc = LLIST_SUCCESS;
+
+	if (list == NULL)
+		return LLIST_NULL_ARGUMENT;
+
+	read_lock(thelist);
+
+	if (msync(thelist->base, thelist->size, MS_SYNC))
+		rc = LLIST_ERROR;
+
+	unlock(thelist);
+
+	return rc;
+}
+
+int pllist_size(pllist list)
+{
+	unsigned int retval;
+
+	if (list == NULL)
+		return 0;
+
+	if (read_lock(list))
+		return LLIST_MULTITHREAD_ISSUE;
+
+	retval = header(list)->count;
+
+	unlock(list);
+
+	return retval;
+}
+
+bool pllist_is_empty(pllist list)
+{
+	return (!pllist_size(list));
+}
+
+int pllist_add_node(pllist list, llist_node node, node_encoder encoder,
+		    int flags)
+{
+	_pllist *thelist = (_pllist *) list;
+	_pllist_header *hdr;
+	_pllist_record *rec;
+	uint64_t offset;
+	size_t len;
+
+	if ((list == NULL) || (encoder == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	len = encoder(node, NULL, 0);
+
+	if (write_lock(thelist))
+		return LLIST_MULTITHREAD_ISSUE;
+
+	offset = alloc_record(thelist, len);
+	if (offset == 0) {
+		unlock(thelist);
+		return LLIST_MALLOC_ERROR;
+	}
+
+	rec = record(thelist, offset);
+	rec->len = encoder(node, rec->data, rec->capacity);
+	if (rec->len > rec->capacity) {
+		// the encoder changed its mind about the size
+		free_record(thelist, offset);
+		unlock(thelist);
+		return LLIST_ERROR;
+	}
+
+	hdr = header(thelist);
+	if (hdr->head == 0) {
+		rec->next = 0;
+		hdr->head = hdr->tail = offset;
+	} else if (flags & ADD_NODE_FRONT) {
+		rec->next = hdr->head;
+		hdr->head = offset;
+	} else {
+		rec->next = 0;
+		record(thelist, hdr->tail)->next = offset;
+		hdr->tail = offset;
+	}
+	hdr->count++;
+
+	unlock(thelist);
+
+	return LLIST_SUCCESS;
+}
+
+int pllist_push(pllist list, llist_node node, node_encoder encoder)
+{
+	return pllist_add_node(list, node, encoder, ADD_NODE_FRONT);
+}
+
+llist_node pllist_pop(pllist list, node_decoder decoder)
+{
+	_pllist *thelist = (_pllist *) list;
+	_pllist_header *hdr;
+	_pllist_record *rec;
+	llist_node node;
+	uint64_t offset;
+
+	if ((list == NULL) || (decoder == NULL))
+		return NULL;
+
+	write_lock(thelist);
+
+	hdr = header(thelist);
+	offset = hdr->head;
+	if (offset == 0) {
+		unlock(thelist);
+		return NULL;
+	}
+
+	rec = record(thelist, offset);
+	node = decoder(rec->data, rec->len);
+	if (node == NULL) {
+		// leave the list alone, the caller can retry
+		unlock(thelist);
+		return NULL;
+	}
+
+	hdr->head = rec->next;
+	if (hdr->head == 0)
+		hdr->tail = 0;
+	hdr->count--;
+	free_record(thelist, offset);
+
+	unlock(thelist);
+
+	return node;
+}
+
+// Payload of the record at offset, NULL if offset is 0
+static const void *payload(_pllist *list, uint64_t offset, size_t *len)
+{
+	if (offset == 0)
+		return NULL;
+
+	if (len)
+		*len = record(list, offset)->len;
+
+	return record(list, offset)->data;
+}
+
+const void *pllist_get_head(pllist list, size_t *len)
+{
+	const void *data;
+
+	if (list == NULL)
+		return NULL;
+
+	read_lock(list);
+	data = payload(list, header(list)->head, len);
+	unlock(list);
+
+	return data;
+}
+
+const void *pllist_get_tail(pllist list, size_t *len)
+{
+	const void *data;
+
+	if (list == NULL)
+		return NULL;
+
+	read_lock(list);
+	data = payload(list, header(list)->tail, len);
+	unlock(list);
+
+	return data;
+}
+
+const void *pllist_peek(pllist list, size_t *len)
+{
+	return pllist_get_head(list, len);
+}
+
+int pllist_for_each(pllist list, pllist_func func, void *arg)
+{
+	_pllist *thelist = (_pllist *) list;
+	_pllist_record *rec;
+	uint64_t offset;
+
+	if ((list == NULL) || (func == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	read_lock(thelist);
+
+	for (offset = header(thelist)->head; offset; offset = rec->next) {
+		rec = record(thelist, offset);
+		func(rec->data, rec->len, arg);
+	}
+
+	unlock(thelist);
+
+	return LLIST_SUCCESS;
+}
@@ -0,0 +1,355 @@
+/*
+ *    Copyright [2013] [Ramon Fried] <ramon.fried at gmail dot com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Shared memory lists: the list header, a process shared lock and a pool of
+ * fixed size slots all live in a region provided by the caller (shm_open,
+ * mmap of a file, MAP_SHARED | MAP_ANONYMOUS before fork...). Links are
+ * offsets from the start of the region, so every process may map it at a
+ * different address, and the handle is simply the region address.
+ *
+ * Nodes are the slots themselves: a producer takes a slot with
+ * shllist_alloc(), fills it in place and links it, a consumer pops it, uses
+ * it in place and gives it back with shllist_free(). Nothing is copied.
+ */
+
+#include "../inc/llist.h"
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#define SHLLIST_MAGIC 0x5453494c4c48535FULL     // "_SHLLIST"
+#define SHLLIST_VERSION 1
+#define SHLLIST_ALIGN 16
+
+typedef struct {
+	uint64_t magic;
+	uint32_t version;
+	uint32_t count;
+	uint64_t slot_size;     // payload bytes per slot
+	uint64_t stride;        // bytes between two slots
+	uint64_t nslots;
+	uint64_t slots;         // offset of the first slot
+	uint64_t head;
+	uint64_t tail;
+	uint64_t free;          // unused slots, linked through next
+	pthread_rwlock_t llist_lock;
+} _shllist;
+
+// The payload of a slot starts right after it, SHLLIST_ALIGN aligned
+typedef struct {
+	uint64_t next;
+	uint64_t pad;
+} _shllist_slot;
+
+static inline uint64_t round_up(uint64_t value)
+{
+	return (value + SHLLIST_ALIGN - 1) & ~(uint64_t) (SHLLIST_ALIGN - 1);
+}
+
+static inline _shllist_slot *slot(_shllist *list, uint64_t offset)
+{
+	return (_shllist_slot *) ((unsigned char *) list + offset);
+}
+
+static inline void *slot_data(_shllist *list, uint64_t offset)
+{
+	return offset ? (unsigned char *) list + offset + sizeof(_shllist_slot) :
+	       NULL;
+}
+
+// Offset of the slot holding data, 0 if data isn't a slot of this list
+static uint64_t data_offset(_shllist *list, void *data)
+{
+	uint64_t offset;
+
+	offset = (unsigned char *) data - (unsigned char *) list -
+		 sizeof(_shllist_slot);
+
+	if (((unsigned char *) data < (unsigned char *) list) ||
+	    (offset < list->slots) ||
+	    ((offset - list->slots) % list->stride) ||
+	    ((offset - list->slots) / list->stride >= list->nslots))
+		return 0;
+
+	return offset;
+}
+
+size_t shllist_region_size(unsigned int slots, size_t slot_size)
+{
+	return round_up(sizeof(_shllist)) +
+	       slots * round_up(sizeof(_shllist_slot) + slot_size);
+}
+
+shllist shllist_create(void *region, size_t size, unsigned int slots,
+		       size_t slot_size)
+{
+	_shllist *new_list = region;
+	pthread_rwlockattr_t attr;
+	unsigned int i;
+	uint64_t offset;
+	int rc;
+
+	if ((region == NULL) || (slots == 0) ||
+	    (size < shllist_region_size(slots, slot_size)) ||
+	    ((uintptr_t) region % SHLLIST_ALIGN))
+		return NULL;
+
+	if (pthread_rwlockattr_init(&attr))
+		return NULL;
+
+	rc = pthread_rwlockattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+	if (rc == 0)
+		rc = pthread_rwlock_init(&new_list->llist_lock, &attr);
+
+	pthread_rwlockattr_destroy(&attr);
+	if (rc != 0)
+		return NULL;
+
+	new_list->version = SHLLIST_VERSION;
+	new_list->count = 0;
+	new_list->slot_size = slot_size;
+	new_list->stride = round_up(sizeof(_shllist_slot) + slot_size);
+	new_list->nslots = slots;
+	new_list->slots = round_up(sizeof(_shllist));
+	new_list->head = 0;
+	new_list->tail = 0;
+
+	// all the slots start on the free list, in address order
+	new_list->free = new_list->slots;
+	for (i = 0; i < slots; i++) {
+		offset = new_list->slots + i * new_list->stride;
+		slot(new_list, offset)->next = (i + 1 < slots) ?
+					       offset + new_list->stride : 0;
+	}
+
+	// publish the list last, shllist_attach() checks the magic
+	__atomic_store_n(&new_list->magic, SHLLIST_MAGIC, __ATOMIC_RELEASE);
+
+	return new_list;
+}
+
+shllist shllist_attach(void *region)
+{
+	_shllist *list = region;
+
+	if ((region == NULL) ||
+	    (__atomic_load_n(&list->magic, __ATOMIC_ACQUIRE) != SHLLIST_MAGIC) ||
+	    (list->version != SHLLIST_VERSION))
+		return NULL;
+
+	return list;
+}
+
+int shllist_destroy(shllist list)
+{
+	_shllist *thelist = (_shllist *) list;
+
+	if (list == NULL)
+		return LLIST_NULL_ARGUMENT;
+
+	__atomic_store_n(&thelist->magic, 0, __ATOMIC_RELEASE);
+	pthread_rwlock_destroy(&thelist->llist_lock);
+
+	return LLIST_SUCCESS;
+}
+
+size_t shllist_slot_size(shllist list)
+{
+	if (list == NULL)
+		return 0;
+
+	return ((_shllist *) list)->slot_size;
+}
+
+void *shllist_alloc(shllist list)
+{
+	_shllist *thelist = (_shllist *) list;
+	uint64_t offset;
+
+	if (list == NULL)
+		return NULL;
+
+	if (pthread_rwlock_wrlock(&thelist->llist_lock))
+		return NULL;
+
+	offset = thelist->free;
+	if (offset)
+		thelist->free = slot(thelist, offset)->next;
+
+	pthread_rwlock_unlock(&thelist->llist_lock);
+
+	return slot_data(thelist, offset);
+}
+
+int shllist_free(shllist list, void *data)
+{
+	_shllist *thelist = (_shllist *) list;
+	uint64_t offset;
+
+	if ((list == NULL) || (data == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	offset = data_offset(thelist, data);
+	if (offset == 0)
+		return LLIST_ERROR;
+
+	if (pthread_rwlock_wrlock(&thelist->llist_lock))
+		return LLIST_MULTITHREAD_ISSUE;
+
+	slot(thelist, offset)->next = thelist->free;
+	thelist->free = offset;
+
+	pthread_rwlock_unlock(&thelist->llist_lock);
+
+	return LLIST_SUCCESS;
+}
+
+int shllist_add_node(shllist list, void *data, int flags)
+{
+	_shllist *thelist = (_shllist *) list;
+	uint64_t offset;
+
+	if ((list == NULL) || (data == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	offset = data_offset(thelist, data);
+	if (offset == 0)
+		return LLIST_ERROR;
+
+	if (pthread_rwlock_wrlock(&thelist->llist_lock))
+		return LLIST_MULTITHREAD_ISSUE;
+
+	if (thelist->head == 0) {
+		slot(thelist, offset)->next = 0;
+		thelist->head = thelist->tail = offset;
+	} else if (flags & ADD_NODE_FRONT) {
+		slot(thelist, offset)->next = thelist->head;
+		thelist->head = offset;
+	} else {
+		slot(thelist, offset)->next = 0;
+		slot(thelist, thelist->tail)->next = offset;
+		thelist->tail = offset;
+	}
+	thelist->count++;
+
+	pthread_rwlock_unlock(&thelist->llist_lock);
+
+	return LLIST_SUCCESS;
+}
+
+void *shllist_pop(shllist list)
+{
+	_shllist *thelist = (_shllist *) list;
+	uint64_t offset;
+
+	if (list == NULL)
+		return NULL;
+
+	if (pthread_rwlock_wrlock(&thelist->llist_lock))
+		return NULL;
+
+	offset = thelist->head;
+	if (offset) {
+		thelist->head = slot(thelist, offset)->next;
+		if (thelist->head == 0)
+			thelist->tail = 0;
+		thelist->count--;
+	}
+
+	pthread_rwlock_unlock(&thelist->llist_lock);
+
+	return slot_data(thelist, offset);
+}
+
+void *shllist_get_head(shllist list)
+{
+	_shllist *thelist = (_shllist *) list;
+	void *data;
+
+	if (list == NULL)
+		return NULL;
+
+	pthread_rwlock_rdlock(&thelist->llist_lock);
+	data = slot_data(thelist, thelist->head);
+	pthread_rwlock_unlock(&thelist->llist_lock);
+
+	return data;
+}
+
+void *shllist_get_tail(shllist list)
+{
+	_shllist *thelist = (_shllist *) list;
+	void *data;
+
+	if (list == NULL)
+		return NULL;
+
+	pthread_rwlock_rdlock(&thelist->llist_lock);
+	data = slot_data(thelist, thelist->tail);
+	pthread_rwlock_unlock(&thelist->llist_lock);
+
+	return data;
+}
+
+void *shllist_peek(shllist list)
+{
+	return shllist_get_head(list);
+}
+
+int shllist_for_each(shllist list, node_func_arg func, void *arg)
+{
+	_shllist *thelist = (_shllist *) list;
+	uint64_t offset;
+
+	if ((list == NULL) || (func == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	if (pthread_rwlock_rdlock(&thelist->llist_lock))
+		return LLIST_MULTITHREAD_ISSUE;
+
+	for (offset = thelist->head; offset;
+	     offset = slot(thelist, offset)->next)
+		func(slot_data(thelist, offset), arg);
+
+	pthread_rwlock_unlock(&thelist->llist_lock);
+
+	return LLIST_SUCCESS;
+}
+
+int shllist_size(shllist list)
+{
+	_shllist *thelist = (_shllist *) list;
+	unsigned int retval;
+
+	if (list == NULL)
+		return 0;
+
+	if (pthread_rwlock_rdlock(&thelist->llist_lock))
+		return LLIST_MULTITHREAD_ISSUE;
+
+	retval = thelist->count;
+
+	pthread_rwlock_unlock(&thelist->llist_lock);
+
+	return retval;
+}
+
+bool shllist_is_empty(shllist list)
+{
+	return (!shllist_size(list));
+}
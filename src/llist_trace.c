@@ -0,0 +1,192 @@
+/*
+ *    Copyright [2013] [Ramon Fried] <ramon.fried at gmail dot com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Ring buffer tracer: a llist_trace_hooks implementation that records every
+ * completed list call into a fixed size ring, overwriting the oldest ones.
+ * Writers only contend on the atomic ring position, the start time of the
+ * calls in progress is kept per thread.
+ */
+
+#include "../inc/llist.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+// deepest nesting of list calls (from list callbacks) that gets recorded
+#define TRACE_MAX_DEPTH 16
+
+typedef struct {
+	unsigned int thread;
+	E_LLIST_OP op;
+	llist list;
+	unsigned long long start;
+	unsigned long long duration;
+	unsigned long count;
+	unsigned long long lock_wait;
+} _trace_record;
+
+typedef struct {
+	llist_trace_hooks hooks;
+	unsigned long long origin;      // start times are relative to this
+	unsigned int capacity;
+	unsigned long long next;        // calls recorded so far, updated atomically
+	_trace_record records[];
+} _llist_tracer;
+
+static const char *op_names[LLIST_OP_COUNT] = {
+	[LLIST_OP_ADD] = "add",
+	[LLIST_OP_INSERT] = "insert",
+	[LLIST_OP_DELETE] = "delete",
+	[LLIST_OP_FIND] = "find",
+	[LLIST_OP_POP] = "pop",
+	[LLIST_OP_READ] = "read",
+	[LLIST_OP_TRAVERSE] = "traverse",
+	[LLIST_OP_SORT] = "sort",
+	[LLIST_OP_RESTRUCTURE] = "restructure",
+	[LLIST_OP_OTHER] = "other",
+};
+
+static unsigned int next_thread_id;
+static __thread unsigned int thread_id;         // 0 until the first call
+static __thread unsigned long long call_start[TRACE_MAX_DEPTH];
+static __thread unsigned int call_depth;
+
+static unsigned long long now_ns(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static void tracer_begin(E_LLIST_OP op, llist list, void *arg)
+{
+	(void) op;
+	(void) list;
+	(void) arg;
+
+	if (call_depth < TRACE_MAX_DEPTH)
+		call_start[call_depth] = now_ns();
+
+	call_depth++;
+}
+
+static void tracer_end(E_LLIST_OP op, llist list, unsigned long count,
+		       unsigned long long lock_wait_ns, void *arg)
+{
+	_llist_tracer *tracer = arg;
+	_trace_record *record;
+	unsigned long long pos, end = now_ns();
+
+	// the call started before the tracer did
+	if (call_depth == 0)
+		return;
+
+	call_depth--;
+	if (call_depth >= TRACE_MAX_DEPTH)
+		return;
+
+	if (thread_id == 0)
+		thread_id = __atomic_add_fetch(&next_thread_id, 1,
+					       __ATOMIC_RELAXED);
+
+	pos = __atomic_fetch_add(&tracer->next, 1, __ATOMIC_RELAXED);
+	record = &tracer->records[pos % tracer->capacity];
+
+	record->thread = thread_id;
+	record->op = op;
+	record->list = list;
+	record->start = call_start[call_depth] - tracer->origin;
+	record->duration = end - call_start[call_depth];
+	record->count = count;
+	record->lock_wait = lock_wait_ns;
+}
+
+llist_tracer llist_tracer_create(unsigned int capacity)
+{
+	_llist_tracer *tracer;
+
+	if (capacity == 0)
+		return NULL;
+
+	tracer = malloc(sizeof(_llist_tracer) +
+			capacity * sizeof(_trace_record));
+	if (tracer == NULL)
+		return NULL;
+
+	tracer->hooks.begin = tracer_begin;
+	tracer->hooks.end = tracer_end;
+	tracer->hooks.arg = tracer;
+	tracer->origin = now_ns();
+	tracer->capacity = capacity;
+	tracer->next = 0;
+
+	return tracer;
+}
+
+void llist_tracer_destroy(llist_tracer tracer)
+{
+	free(tracer);
+}
+
+int llist_tracer_start(llist_tracer tracer)
+{
+	if (tracer == NULL)
+		return LLIST_NULL_ARGUMENT;
+
+	return llist_set_trace_hooks(&((_llist_tracer *) tracer)->hooks);
+}
+
+int llist_tracer_stop(llist_tracer tracer)
+{
+	if (tracer == NULL)
+		return LLIST_NULL_ARGUMENT;
+
+	return llist_set_trace_hooks(NULL);
+}
+
+int llist_tracer_dump(llist_tracer tracer, FILE *file)
+{
+	_llist_tracer *thetracer = (_llist_tracer *) tracer;
+	_trace_record *record;
+	unsigned long long total, pos;
+
+	if ((tracer == NULL) || (file == NULL))
+		return LLIST_NULL_ARGUMENT;
+
+	total = __atomic_load_n(&thetracer->next, __ATOMIC_RELAXED);
+	pos = (total > thetracer->capacity) ? total - thetracer->capacity : 0;
+
+	fprintf(file, "#thread\top\tlist\tstart_ns\tduration_ns\tcount\t"
+		"lock_wait_ns\n");
+
+	for (; pos < total; pos++) {
+		record = &thetracer->records[pos % thetracer->capacity];
+
+		fprintf(file, "%u\t%s\t%p\t%llu\t%llu\t%lu\t%llu\n",
+			record->thread, op_names[record->op], record->list,
+			record->start, record->duration, record->count,
+			record->lock_wait);
+	}
+
+	if (fflush(file) || ferror(file))
+		return LLIST_ERROR;
+
+	return LLIST_SUCCESS;
+}
@@ -20,6 +20,13 @@
 #include <pthread.h>
 #include <stdbool.h>
 #include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sched.h>
+#include <limits.h>
 #include <check.h>
 #include "../inc/llist.h"
 
@@ -676,6 +683,8 @@ START_TEST(llist_18_null_arguments)
 					   ADD_NODE_AFTER), LLIST_NULL_ARGUMENT);
 	ck_assert_int_eq(llist_find_node(NULL, (llist_node) 1, &out),
 			 LLIST_NULL_ARGUMENT);
+	ck_assert_int_eq(llist_find_sorted(NULL, (llist_node) 1, &out),
+			 LLIST_NULL_ARGUMENT);
 	ck_assert_int_eq(llist_sort(NULL, SORT_LIST_ASCENDING),
 			 LLIST_NULL_ARGUMENT);
 	ck_assert_int_eq(llist_reverse(NULL), LLIST_NULL_ARGUMENT);
@@ -686,6 +695,2027 @@ START_TEST(llist_18_null_arguments)
 }
 END_TEST
 
+START_TEST(llist_19_top_k_partial_sort)
+{
+	int retval;
+	llist_node out[4];
+	unsigned long values[] = {7, 3, 9, 1, 8, 2, 6, 5, 4};
+	llist listToTest = llist_create(trivial_comperator, trivial_equal,
+					test_mt ? FLAG_MT_SUPPORT : 0);
+
+	for (unsigned long i = 0; i < 9; i++)
+		llist_add_node(listToTest, (llist_node) values[i], ADD_NODE_REAR);
+
+	retval = llist_top_k(listToTest, 3, SORT_LIST_ASCENDING, out);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	ck_assert_int_eq((unsigned long) out[0], 1);
+	ck_assert_int_eq((unsigned long) out[1], 2);
+	ck_assert_int_eq((unsigned long) out[2], 3);
+
+	retval = llist_top_k(listToTest, 2, SORT_LIST_DESCENDING, out);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	ck_assert_int_eq((unsigned long) out[0], 9);
+	ck_assert_int_eq((unsigned long) out[1], 8);
+
+	/* top_k only reads, the list must be untouched */
+	ck_assert_ptr_eq(llist_get_head(listToTest), (llist_node) 7);
+	ck_assert_int_eq(llist_size(listToTest), 9);
+
+	retval = llist_partial_sort(listToTest, 4, SORT_LIST_ASCENDING);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	ck_assert_int_eq(llist_size(listToTest), 9);
+
+	printf("List after partial sort of 4: ");
+	print_llist(listToTest);
+
+	for (unsigned long i = 1; i <= 4; i++)
+		ck_assert_int_eq((unsigned long) llist_pop(listToTest), i);
+
+	/* the tail must still be valid for appending */
+	llist_add_node(listToTest, (llist_node) 10, ADD_NODE_REAR);
+	ck_assert_ptr_eq(llist_get_tail(listToTest), (llist_node) 10);
+
+	/* asking for more nodes than available pads the output with NULL */
+	llist_destroy(listToTest, false, NULL);
+	listToTest = llist_create(trivial_comperator, trivial_equal,
+				  test_mt ? FLAG_MT_SUPPORT : 0);
+	llist_add_node(listToTest, (llist_node) 2, ADD_NODE_REAR);
+	llist_add_node(listToTest, (llist_node) 1, ADD_NODE_REAR);
+
+	retval = llist_top_k(listToTest, 4, SORT_LIST_ASCENDING, out);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	ck_assert_int_eq((unsigned long) out[0], 1);
+	ck_assert_int_eq((unsigned long) out[1], 2);
+	ck_assert_ptr_eq(out[2], NULL);
+	ck_assert_ptr_eq(out[3], NULL);
+
+	retval = llist_partial_sort(listToTest, 5, SORT_LIST_ASCENDING);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	ck_assert_ptr_eq(llist_get_head(listToTest), (llist_node) 1);
+	ck_assert_ptr_eq(llist_get_tail(listToTest), (llist_node) 2);
+
+	llist_destroy(listToTest, false, NULL);
+}
+END_TEST
+
+void sum_node_func(llist_node node, void *arg)
+{
+	*(unsigned long *) arg += (unsigned long) node;
+}
+
+START_TEST(llist_20_min_max_aggregate)
+{
+	int retval;
+	llist_node min, max;
+	llist_aggregate_result result;
+	unsigned long sum = 0;
+	unsigned long values[] = {4, 9, 2, 7, 1, 8, 6};
+	llist listToTest = llist_create(trivial_comperator, trivial_equal,
+					test_mt ? FLAG_MT_SUPPORT : 0);
+
+	retval = llist_get_min_max_both(listToTest, &min, &max);
+	ck_assert_int_eq(retval, LLIST_NODE_NOT_FOUND);
+
+	/* odd number of nodes exercises the unpaired tail */
+	for (unsigned long i = 0; i < 7; i++)
+		llist_add_node(listToTest, (llist_node) values[i], ADD_NODE_REAR);
+
+	retval = llist_get_min_max_both(listToTest, &min, &max);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	ck_assert_int_eq((unsigned long) min, 1);
+	ck_assert_int_eq((unsigned long) max, 9);
+
+	/* and an even number of nodes */
+	llist_add_node(listToTest, (llist_node) 10, ADD_NODE_REAR);
+	retval = llist_get_min_max_both(listToTest, &min, &max);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	ck_assert_int_eq((unsigned long) max, 10);
+
+	retval = llist_aggregate(listToTest, &result, sum_node_func, &sum);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	ck_assert_int_eq(result.count, 8);
+	ck_assert_int_eq((unsigned long) result.min, 1);
+	ck_assert_int_eq((unsigned long) result.max, 10);
+	ck_assert_int_eq(sum, 47);
+
+	llist_destroy(listToTest, false, NULL);
+
+	/* without a comparator only the count and fold are available */
+	listToTest = llist_create(NULL, NULL, test_mt ? FLAG_MT_SUPPORT : 0);
+	llist_add_node(listToTest, (llist_node) 3, ADD_NODE_REAR);
+	llist_add_node(listToTest, (llist_node) 5, ADD_NODE_REAR);
+
+	ck_assert_int_eq(llist_get_min_max_both(listToTest, &min, &max),
+			 LLIST_COMPERATOR_MISSING);
+
+	retval = llist_aggregate(listToTest, &result, NULL, NULL);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	ck_assert_int_eq(result.count, 2);
+	ck_assert_ptr_eq(result.min, NULL);
+	ck_assert_ptr_eq(result.max, NULL);
+
+	llist_destroy(listToTest, false, NULL);
+}
+END_TEST
+
+int ulong_comperator(llist_node first, llist_node second)
+{
+	unsigned long a = *(unsigned long *) first;
+	unsigned long b = *(unsigned long *) second;
+
+	return (a > b) - (a < b);
+}
+
+size_t ulong_encoder(llist_node node, void *buf, size_t len)
+{
+	if (len >= sizeof(unsigned long))
+		memcpy(buf, node, sizeof(unsigned long));
+
+	return sizeof(unsigned long);
+}
+
+llist_node ulong_decoder(const void *buf, size_t len)
+{
+	unsigned long *node;
+
+	if (len != sizeof(unsigned long))
+		return NULL;
+
+	node = malloc(sizeof(unsigned long));
+	memcpy(node, buf, sizeof(unsigned long));
+	return node;
+}
+
+llist_node new_ulong(unsigned long value)
+{
+	unsigned long *node = malloc(sizeof(unsigned long));
+
+	*node = value;
+	return node;
+}
+
+// encodes into a buffer left before failing_encoder() fails, -1 for no limit
+int encode_budget = -1;
+
+// Claims more room than it's given once the budget is spent, spills fail
+size_t failing_encoder(llist_node node, void *buf, size_t len)
+{
+	if (buf && (encode_budget == 0))
+		return len + 1;
+
+	if (buf && (encode_budget > 0))
+		encode_budget--;
+
+	return ulong_encoder(node, buf, len);
+}
+
+void check_descending(llist_node node, void *arg)
+{
+	unsigned long *last = arg;
+
+	ck_assert_int_le(*(unsigned long *) node, *last);
+	*last = *(unsigned long *) node;
+	free(node);
+}
+
+START_TEST(llist_21_external_sort)
+{
+	int retval;
+	unsigned long *node, last;
+	llist input = llist_create(NULL, NULL, test_mt ? FLAG_MT_SUPPORT : 0);
+	llist output = llist_create(ulong_comperator, NULL,
+				    test_mt ? FLAG_MT_SUPPORT : 0);
+
+	/* a tiny memory cap forces plenty of spilled runs */
+	llist_sorter sorter = llist_sorter_create(ulong_comperator,
+						  SORT_LIST_ASCENDING, 128,
+						  ulong_encoder, ulong_decoder,
+						  NULL);
+	ck_assert_ptr_ne(sorter, NULL);
+
+	for (unsigned long i = 0; i < 500; i++)
+		llist_add_node(input, new_ulong((i * 7919) % 500), ADD_NODE_REAR);
+
+	retval = llist_sorter_add_list(sorter, input);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	ck_assert_int_eq(llist_size(input), 0);
+
+	retval = llist_sorter_finish(sorter, output);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	ck_assert_int_eq(llist_size(output), 500);
+
+	for (unsigned long i = 0; i < 500; i++) {
+		node = llist_pop(output);
+		ck_assert_int_eq(*node, i);
+		free(node);
+	}
+
+	llist_sorter_destroy(sorter, true);
+
+	/* stream a descending sort to a callback, once fully in memory and
+	 * once through the disk */
+	for (size_t limit = 0; limit <= 64; limit += 64) {
+		sorter = llist_sorter_create(ulong_comperator,
+					     SORT_LIST_DESCENDING, limit,
+					     ulong_encoder, ulong_decoder, NULL);
+
+		for (unsigned long i = 0; i < 100; i++) {
+			retval = llist_sorter_add(sorter, new_ulong(i % 37));
+			ck_assert_int_eq(retval, LLIST_SUCCESS);
+		}
+
+		last = 100;
+		retval = llist_sorter_finish_each(sorter, check_descending, &last);
+		ck_assert_int_eq(retval, LLIST_SUCCESS);
+		ck_assert_int_eq(last, 0);
+
+		llist_sorter_destroy(sorter, true);
+	}
+
+	ck_assert_ptr_eq(llist_sorter_create(NULL, 0, 0, ulong_encoder,
+					     ulong_decoder, NULL), NULL);
+
+	/* a failed spill leaves the node that triggered it with the caller */
+	sorter = llist_sorter_create(ulong_comperator, SORT_LIST_ASCENDING, 64,
+				     failing_encoder, ulong_decoder, NULL);
+	for (unsigned long i = 0; i < 10; i++)
+		llist_add_node(input, new_ulong(i), ADD_NODE_REAR);
+
+	encode_budget = 0;
+	retval = llist_sorter_add_list(sorter, input);
+	ck_assert_int_eq(retval, LLIST_ERROR);
+	ck_assert_int_eq(llist_size(input), 8);
+	ck_assert_int_eq(*(unsigned long *) llist_peek(input), 2);
+
+	node = llist_pop(input);
+	ck_assert_int_eq(llist_sorter_add(sorter, node), LLIST_ERROR);
+	llist_push(input, node);
+	encode_budget = -1;
+
+	llist_sorter_destroy(sorter, true);
+
+	/* a spill failing halfway through keeps the nodes it didn't finish */
+	sorter = llist_sorter_create(ulong_comperator, SORT_LIST_ASCENDING, 64,
+				     failing_encoder, ulong_decoder, NULL);
+	llist_sorter_add(sorter, new_ulong(2));
+	llist_sorter_add(sorter, new_ulong(1));
+
+	node = new_ulong(0);
+	encode_budget = 1;	// the first record goes through
+	ck_assert_int_eq(llist_sorter_add(sorter, node), LLIST_ERROR);
+	encode_budget = -1;
+	ck_assert_int_eq(llist_sorter_add(sorter, node), LLIST_SUCCESS);
+
+	retval = llist_sorter_finish(sorter, output);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	for (unsigned long i = 0; i < 3; i++) {
+		node = llist_pop(output);
+		ck_assert_int_eq(*node, i);
+		free(node);
+	}
+	ck_assert(llist_is_empty(output));
+	llist_sorter_destroy(sorter, true);
+
+	/* a list refusing nodes stops the merge, finishing again resumes it */
+	llist full = llist_create_ring(NULL, NULL, 4, FLAG_RING_BOUNDED);
+
+	sorter = llist_sorter_create(ulong_comperator, SORT_LIST_ASCENDING, 64,
+				     ulong_encoder, ulong_decoder, NULL);
+	for (unsigned long i = 0; i < 10; i++)
+		llist_sorter_add(sorter, new_ulong(9 - i));
+
+	last = 0;
+	while ((retval = llist_sorter_finish(sorter, full)) == LLIST_FULL) {
+		node = new_ulong(0);
+		ck_assert_int_eq(llist_sorter_add(sorter, node), LLIST_ERROR);
+		free(node);
+
+		while ((node = llist_pop(full)) != NULL) {
+			ck_assert_int_eq(*node, last++);
+			free(node);
+		}
+	}
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	while ((node = llist_pop(full)) != NULL) {
+		ck_assert_int_eq(*node, last++);
+		free(node);
+	}
+	ck_assert_int_eq(last, 10);
+
+	llist_sorter_destroy(sorter, true);
+	llist_destroy(full, false, NULL);
+
+	llist_destroy(input, true, NULL);
+	llist_destroy(output, true, NULL);
+}
+END_TEST
+
+START_TEST(llist_22_keyed_lists)
+{
+	int retval;
+	llist_node found, other;
+	int64_t key;
+	double dkey;
+	llist_keyed simd, scalar, dlist, blist;
+
+	simd = llist_keyed_create(LLIST_KEY_INT64, 0,
+				  test_mt ? FLAG_MT_SUPPORT : 0);
+	scalar = llist_keyed_create(LLIST_KEY_INT64, 0, FLAG_NO_SIMD |
+				    (test_mt ? FLAG_MT_SUPPORT : 0));
+	ck_assert_ptr_ne(simd, NULL);
+	ck_assert_ptr_ne(scalar, NULL);
+
+	retval = llist_keyed_get_min(simd, &found);
+	ck_assert_int_eq(retval, LLIST_NODE_NOT_FOUND);
+
+	/* enough nodes to span several blocks, from both ends */
+	for (unsigned long i = 0; i < 300; i++) {
+		key = (int64_t)((i * 7919) % 211) - 100;
+		retval = llist_keyed_add_node(simd, &key, (llist_node) i,
+					      (i & 1) ? ADD_NODE_FRONT : ADD_NODE_REAR);
+		ck_assert_int_eq(retval, LLIST_SUCCESS);
+		llist_keyed_add_node(scalar, &key, (llist_node) i,
+				     (i & 1) ? ADD_NODE_FRONT : ADD_NODE_REAR);
+	}
+	ck_assert_int_eq(llist_keyed_size(simd), 300);
+
+	/* the vector kernels must agree with the scalar ones */
+	for (key = -105; key <= 115; key++) {
+		ck_assert_int_eq(llist_keyed_count(simd, &key),
+				 llist_keyed_count(scalar, &key));
+
+		retval = llist_keyed_find_node(simd, &key, &found);
+		ck_assert_int_eq(retval, llist_keyed_find_node(scalar, &key,
+				 &other));
+		if (retval == LLIST_SUCCESS)
+			ck_assert_ptr_eq(found, other);
+	}
+
+	llist_keyed_get_min(simd, &found);
+	llist_keyed_get_min(scalar, &other);
+	ck_assert_ptr_eq(found, other);
+	llist_keyed_get_max(simd, &found);
+	llist_keyed_get_max(scalar, &other);
+	ck_assert_ptr_eq(found, other);
+
+	/* min key is -100, max key is 110 */
+	key = -100;
+	ck_assert_int_eq(llist_keyed_count(simd, &key), 2);
+
+	/* delete everything matching the max key, then the max must move */
+	key = 110;
+	while (llist_keyed_delete_node(simd, &key, false, NULL) == LLIST_SUCCESS)
+		;
+	ck_assert_int_eq(llist_keyed_count(simd, &key), 0);
+	ck_assert_int_eq(llist_keyed_size(simd), 298);
+
+	/* empty the list completely, releasing all of its blocks */
+	for (key = -100; key <= 110; key++)
+		while (llist_keyed_delete_node(simd, &key, false, NULL) ==
+		       LLIST_SUCCESS)
+			;
+	ck_assert_int_eq(llist_keyed_size(simd), 0);
+	key = 1;
+	ck_assert_int_eq(llist_keyed_add_node(simd, &key, (llist_node) 1,
+					      ADD_NODE_REAR), LLIST_SUCCESS);
+	ck_assert_int_eq(llist_keyed_find_node(simd, &key, &found),
+			 LLIST_SUCCESS);
+
+	/* churn leaves sparse blocks behind, they get folded together */
+	for (unsigned long i = 0; i < 640; i++) {
+		key = 1000 + i;
+		llist_keyed_add_node(scalar, &key, (llist_node) i, ADD_NODE_REAR);
+	}
+	for (key = 1000; key < 1640; key++)
+		if (key % 8)
+			ck_assert_int_eq(llist_keyed_delete_node(scalar, &key,
+								 false, NULL),
+					 LLIST_SUCCESS);
+	ck_assert_int_eq(llist_keyed_size(scalar), 300 + 80);
+	for (key = 1000; key < 1640; key += 8) {
+		ck_assert_int_eq(llist_keyed_find_node(scalar, &key, &found),
+				 LLIST_SUCCESS);
+		ck_assert_int_eq((unsigned long) found, key - 1000);
+	}
+	key = -200;
+	llist_keyed_add_node(scalar, &key, (llist_node) 1000, ADD_NODE_FRONT);
+	llist_keyed_get_min(scalar, &found);
+	ck_assert_int_eq((unsigned long) found, 1000);
+	llist_keyed_get_max(scalar, &found);
+	ck_assert_int_eq((unsigned long) found, 632);
+
+	llist_keyed_destroy(simd, false, NULL);
+	llist_keyed_destroy(scalar, false, NULL);
+
+	dlist = llist_keyed_create(LLIST_KEY_DOUBLE, 0,
+				   test_mt ? FLAG_MT_SUPPORT : 0);
+	for (unsigned long i = 1; i <= 10; i++) {
+		dkey = 1.0 / i;
+		llist_keyed_add_node(dlist, &dkey, (llist_node) i, ADD_NODE_REAR);
+	}
+	llist_keyed_get_min(dlist, &found);
+	ck_assert_int_eq((unsigned long) found, 10);
+	llist_keyed_get_max(dlist, &found);
+	ck_assert_int_eq((unsigned long) found, 1);
+	dkey = 0.25;
+	ck_assert_int_eq(llist_keyed_find_node(dlist, &dkey, &found),
+			 LLIST_SUCCESS);
+	ck_assert_int_eq((unsigned long) found, 4);
+	llist_keyed_destroy(dlist, false, NULL);
+
+	blist = llist_keyed_create(LLIST_KEY_BYTES, 3,
+				   test_mt ? FLAG_MT_SUPPORT : 0);
+	llist_keyed_add_node(blist, "bbb", (llist_node) 2, ADD_NODE_REAR);
+	llist_keyed_add_node(blist, "aaa", (llist_node) 1, ADD_NODE_REAR);
+	llist_keyed_add_node(blist, "ccc", (llist_node) 3, ADD_NODE_REAR);
+	llist_keyed_get_min(blist, &found);
+	ck_assert_int_eq((unsigned long) found, 1);
+	llist_keyed_get_max(blist, &found);
+	ck_assert_int_eq((unsigned long) found, 3);
+	ck_assert_int_eq(llist_keyed_count(blist, "bbb"), 1);
+	llist_keyed_destroy(blist, false, NULL);
+
+	ck_assert_ptr_eq(llist_keyed_create(LLIST_KEY_BYTES, 0, 0), NULL);
+}
+END_TEST
+
+START_TEST(llist_23_find_sorted)
+{
+	int retval;
+	llist_node found;
+	llist listToTest = llist_create(trivial_comperator, trivial_equal,
+					test_mt ? FLAG_MT_SUPPORT : 0);
+
+	ck_assert_int_eq(llist_find_sorted(listToTest, (llist_node) 1, &found),
+			 LLIST_NODE_NOT_FOUND);
+
+	/* even values only, so odd ones exercise the misses */
+	for (unsigned long i = 0; i < 1000; i++)
+		llist_add_node(listToTest, (llist_node)(((i * 7919) % 1000) * 2),
+			       ADD_NODE_REAR);
+
+	/* not sorted yet, must still work through a linear scan */
+	retval = llist_find_sorted(listToTest, (llist_node) 1500, &found);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	ck_assert_ptr_eq(found, (llist_node) 1500);
+
+	int directions[] = {SORT_LIST_ASCENDING, SORT_LIST_DESCENDING};
+
+	for (int d = 0; d < 2; d++) {
+		retval = llist_sort(listToTest, directions[d]);
+		ck_assert_int_eq(retval, LLIST_SUCCESS);
+
+		for (unsigned long i = 0; i < 2002; i++) {
+			retval = llist_find_sorted(listToTest, (llist_node) i,
+						   &found);
+			if (i & 1 || i >= 2000) {
+				ck_assert_int_eq(retval, LLIST_NODE_NOT_FOUND);
+			} else {
+				ck_assert_int_eq(retval, LLIST_SUCCESS);
+				ck_assert_ptr_eq(found, (llist_node) i);
+			}
+		}
+	}
+
+	/* adding a node breaks the order, it must still be found */
+	llist_add_node(listToTest, (llist_node) 3001, ADD_NODE_REAR);
+	retval = llist_find_sorted(listToTest, (llist_node) 3001, &found);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	retval = llist_find_sorted(listToTest, (llist_node) 2, &found);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+
+	llist_destroy(listToTest, false, NULL);
+}
+END_TEST
+
+START_TEST(llist_24_iterator)
+{
+	int retval;
+	llist_iter iter;
+	llist_node node;
+	unsigned long visited[8], nvisited = 0;
+	unsigned long expected_visits[] = {1, 2, 3, 4, 12};
+	unsigned long expected_list[] = {10, 2, 4, 12, 5, 6, 7};
+	llist listToTest = llist_create(trivial_comperator, trivial_equal,
+					test_mt ? FLAG_MT_SUPPORT : 0);
+
+	for (unsigned long i = 1; i <= 6; i++)
+		llist_add_node(listToTest, (llist_node) i, ADD_NODE_REAR);
+
+	/* drop odd nodes, insert around even ones and stop early */
+	retval = llist_iter_begin(listToTest, &iter, 0);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+
+	while (llist_iter_next(&iter, &node) == LLIST_SUCCESS) {
+		unsigned long value = (unsigned long) node;
+
+		visited[nvisited++] = value;
+
+		if (value == 12)
+			break;
+
+		if (value & 1) {
+			retval = llist_iter_remove(&iter, false, NULL);
+			ck_assert_int_eq(retval, LLIST_SUCCESS);
+			/* nothing is under the cursor anymore */
+			retval = llist_iter_remove(&iter, false, NULL);
+			ck_assert_int_eq(retval, LLIST_NODE_NOT_FOUND);
+		} else if (value == 2) {
+			/* behind the cursor, never visited */
+			retval = llist_iter_insert_before(&iter, (llist_node) 10);
+			ck_assert_int_eq(retval, LLIST_SUCCESS);
+		} else if (value == 4) {
+			/* visited right after 4 */
+			retval = llist_iter_insert_after(&iter, (llist_node) 12);
+			ck_assert_int_eq(retval, LLIST_SUCCESS);
+		}
+	}
+
+	llist_iter_end(&iter);
+
+	ck_assert_int_eq(nvisited, 5);
+	for (unsigned long i = 0; i < nvisited; i++)
+		ck_assert_int_eq(visited[i], expected_visits[i]);
+
+	/* appending at the end of the walk must update the tail */
+	llist_iter_begin(listToTest, &iter, 0);
+	while (llist_iter_next(&iter, &node) == LLIST_SUCCESS)
+		;
+	retval = llist_iter_insert_before(&iter, (llist_node) 7);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	llist_iter_end(&iter);
+	ck_assert_ptr_eq(llist_get_tail(listToTest), (llist_node) 7);
+
+	/* read only iterators can't modify the list */
+	retval = llist_iter_begin(listToTest, &iter, ITER_READ_ONLY);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	ck_assert_int_eq(llist_iter_insert_after(&iter, (llist_node) 1),
+			 LLIST_ERROR);
+	llist_iter_end(&iter);
+
+	ck_assert_int_eq(llist_size(listToTest), 7);
+	for (unsigned long i = 0; i < 7; i++)
+		ck_assert_int_eq((unsigned long) llist_pop(listToTest),
+				 expected_list[i]);
+
+	llist_destroy(listToTest, false, NULL);
+}
+END_TEST
+
+bool stop_at_arg(llist_node node, void *arg)
+{
+	return node == arg;
+}
+
+bool is_multiple_of(llist_node node, void *arg)
+{
+	return ((unsigned long) node % (unsigned long) arg) == 0;
+}
+
+START_TEST(llist_25_for_each_until_remove_if)
+{
+	int retval;
+	llist listToTest = llist_create(trivial_comperator, trivial_equal,
+					test_mt ? FLAG_MT_SUPPORT : 0);
+
+	for (unsigned long i = 1; i <= 10; i++)
+		llist_add_node(listToTest, (llist_node) i, ADD_NODE_REAR);
+
+	retval = llist_for_each_until(listToTest, stop_at_arg, (void *) 4);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	retval = llist_for_each_until(listToTest, stop_at_arg, (void *) 11);
+	ck_assert_int_eq(retval, LLIST_NODE_NOT_FOUND);
+
+	/* removes 3, 6 and 9, including neither the head nor the tail */
+	retval = llist_remove_if(listToTest, is_multiple_of, (void *) 3,
+				 false, NULL);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	ck_assert_int_eq(llist_size(listToTest), 7);
+	ck_assert_ptr_eq(llist_get_tail(listToTest), (llist_node) 10);
+
+	/* removes the tail (10) and the head (2) too */
+	retval = llist_remove_if(listToTest, is_multiple_of, (void *) 2,
+				 false, NULL);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	ck_assert_int_eq(llist_size(listToTest), 3);
+	ck_assert_ptr_eq(llist_get_head(listToTest), (llist_node) 1);
+	ck_assert_ptr_eq(llist_get_tail(listToTest), (llist_node) 7);
+
+	llist_add_node(listToTest, (llist_node) 11, ADD_NODE_REAR);
+	ck_assert_ptr_eq(llist_get_tail(listToTest), (llist_node) 11);
+
+	/* everything goes */
+	retval = llist_remove_if(listToTest, is_multiple_of, (void *) 1,
+				 false, NULL);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	ck_assert_int_eq(llist_is_empty(listToTest), true);
+	ck_assert_ptr_eq(llist_get_tail(listToTest), NULL);
+
+	llist_destroy(listToTest, false, NULL);
+}
+END_TEST
+
+void atomic_sum_node_func(llist_node node, void *arg)
+{
+	__atomic_fetch_add((unsigned long *) arg, (unsigned long) node,
+			   __ATOMIC_RELAXED);
+}
+
+void *identity_map(llist_node node, void *arg)
+{
+	return node;
+}
+
+void *sum_combine(void *first, void *second, void *arg)
+{
+	return (void *)((unsigned long) first + (unsigned long) second);
+}
+
+/* not commutative, checks segments are reduced in list order */
+void *last_combine(void *first, void *second, void *arg)
+{
+	return second;
+}
+
+START_TEST(llist_26_parallel_for_each)
+{
+	int retval;
+	unsigned long sum;
+	void *result;
+	llist listToTest = llist_create(trivial_comperator, trivial_equal,
+					test_mt ? FLAG_MT_SUPPORT : 0);
+
+	retval = llist_parallel_map_reduce(listToTest, identity_map,
+					   sum_combine, NULL, 4, &result);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	ck_assert_ptr_eq(result, NULL);
+
+	for (unsigned long i = 1; i <= 1001; i++)
+		llist_add_node(listToTest, (llist_node) i, ADD_NODE_REAR);
+
+	/* more threads than nodes, an uneven split and the CPU count */
+	unsigned int threads[] = {1, 3, 4, 0, 2000};
+
+	for (int t = 0; t < 5; t++) {
+		sum = 0;
+		retval = llist_parallel_for_each(listToTest, atomic_sum_node_func,
+						 &sum, threads[t]);
+		ck_assert_int_eq(retval, LLIST_SUCCESS);
+		ck_assert_int_eq(sum, 1001 * 1002 / 2);
+
+		retval = llist_parallel_map_reduce(listToTest, identity_map,
+						   sum_combine, NULL,
+						   threads[t], &result);
+		ck_assert_int_eq(retval, LLIST_SUCCESS);
+		ck_assert_int_eq((unsigned long) result, 1001 * 1002 / 2);
+
+		retval = llist_parallel_map_reduce(listToTest, identity_map,
+						   last_combine, NULL,
+						   threads[t], &result);
+		ck_assert_int_eq(retval, LLIST_SUCCESS);
+		ck_assert_int_eq((unsigned long) result, 1001);
+	}
+
+	llist_destroy(listToTest, false, NULL);
+}
+END_TEST
+
+llist_node move_ulong(llist_node node, void *arg)
+{
+	llist_node moved = new_ulong(*(unsigned long *) node);
+
+	(*(unsigned long *) arg)++;
+	free(node);
+	return moved;
+}
+
+START_TEST(llist_27_compact)
+{
+	int retval;
+	unsigned long moved = 0;
+	llist_node found;
+	llist listToTest = llist_create(ulong_comperator, NULL,
+					test_mt ? FLAG_MT_SUPPORT : 0);
+	llist other = llist_create(trivial_comperator, trivial_equal,
+				   test_mt ? FLAG_MT_SUPPORT : 0);
+
+	ck_assert_int_eq(llist_compact(listToTest, NULL, NULL), LLIST_SUCCESS);
+
+	for (unsigned long i = 0; i < 100; i++)
+		llist_add_node(listToTest, new_ulong(99 - i), ADD_NODE_REAR);
+
+	llist_sort(listToTest, SORT_LIST_ASCENDING);
+
+	retval = llist_compact(listToTest, move_ulong, &moved);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	ck_assert_int_eq(moved, 100);
+	ck_assert_int_eq(llist_size(listToTest), 100);
+
+	/* the order is kept, and so is the sorted lookup */
+	unsigned long key = 42;
+	retval = llist_find_sorted(listToTest, &key, &found);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	ck_assert_int_eq(*(unsigned long *) found, 42);
+
+	for (unsigned long i = 0; i < 50; i++) {
+		unsigned long *node = llist_pop(listToTest);
+
+		ck_assert_int_eq(*node, i);
+		free(node);
+	}
+
+	/* compacted and malloc'ed wrappers can live side by side */
+	llist_add_node(listToTest, new_ulong(100), ADD_NODE_REAR);
+	ck_assert_int_eq(*(unsigned long *) llist_get_tail(listToTest), 100);
+	llist_destroy(listToTest, true, NULL);
+
+	/* wrappers of a compacted list outlive it when moved elsewhere */
+	listToTest = llist_create(trivial_comperator, trivial_equal,
+				  test_mt ? FLAG_MT_SUPPORT : 0);
+	for (unsigned long i = 1; i <= 10; i++)
+		llist_add_node(listToTest, (llist_node) i, ADD_NODE_REAR);
+	llist_compact(listToTest, NULL, NULL);
+	llist_compact(listToTest, NULL, NULL);
+
+	llist_concat(other, listToTest);
+	llist_destroy(listToTest, false, NULL);
+
+	ck_assert_int_eq(llist_size(other), 10);
+	retval = llist_delete_node(other, (llist_node) 5, false, NULL);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	ck_assert_ptr_eq(llist_get_tail(other), (llist_node) 10);
+
+	llist_destroy(other, false, NULL);
+}
+END_TEST
+
+void *stats_add_nodes(void *arg)
+{
+	for (unsigned long i = 1; i <= 1000; i++)
+		llist_add_node(arg, (llist_node) i, ADD_NODE_REAR);
+
+	return NULL;
+}
+
+START_TEST(llist_28_stats)
+{
+	int retval;
+	llist_node found;
+	llist_stats stats;
+	unsigned long long waits = 0;
+	pthread_t threads[4];
+	llist listToTest = llist_create(trivial_comperator, trivial_equal,
+					FLAG_STATS |
+					(test_mt ? FLAG_MT_SUPPORT : 0));
+	llist plain = llist_create(trivial_comperator, trivial_equal,
+				   test_mt ? FLAG_MT_SUPPORT : 0);
+
+	ck_assert_int_eq(llist_get_stats(plain, &stats), LLIST_ERROR);
+	ck_assert_int_eq(llist_get_stats(listToTest, NULL), LLIST_NULL_ARGUMENT);
+
+	for (unsigned long i = 1; i <= 10; i++)
+		llist_add_node(listToTest, (llist_node) i, ADD_NODE_REAR);
+
+	retval = llist_find_node(listToTest, (llist_node) 6, &found);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	retval = llist_delete_node(listToTest, (llist_node) 3, false, NULL);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	llist_for_each(listToTest, trivial_node_func);
+	llist_pop(listToTest);
+
+	retval = llist_get_stats(listToTest, &stats);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	ck_assert_int_eq(stats.ops[LLIST_OP_ADD], 10);
+	ck_assert_int_eq(stats.allocations, 10);
+	ck_assert_int_eq(stats.ops[LLIST_OP_FIND], 1);
+	ck_assert_int_eq(stats.scanned[LLIST_OP_FIND], 6);
+	ck_assert_int_eq(stats.ops[LLIST_OP_DELETE], 1);
+	ck_assert_int_eq(stats.scanned[LLIST_OP_DELETE], 3);
+	ck_assert_int_eq(stats.ops[LLIST_OP_TRAVERSE], 1);
+	ck_assert_int_eq(stats.scanned[LLIST_OP_TRAVERSE], 9);
+	ck_assert_int_eq(stats.ops[LLIST_OP_POP], 1);
+	ck_assert_int_eq(stats.peak_size, 10);
+
+	if (test_mt) {
+		ck_assert_int_eq(stats.lock_acquisitions, 14);
+	} else {
+		ck_assert_int_eq(stats.lock_acquisitions, 0);
+	}
+
+	/* counters from several threads add up */
+	if (test_mt) {
+		for (int i = 0; i < 4; i++)
+			pthread_create(&threads[i], NULL, stats_add_nodes,
+				       listToTest);
+		for (int i = 0; i < 4; i++)
+			pthread_join(threads[i], NULL);
+
+		llist_get_stats(listToTest, &stats);
+		ck_assert_int_eq(stats.ops[LLIST_OP_ADD], 4010);
+		ck_assert_int_eq(stats.peak_size, 4008);
+
+		for (int i = 0; i < LLIST_LOCK_WAIT_BUCKETS; i++)
+			waits += stats.lock_wait_histogram[i];
+
+		ck_assert_int_eq(waits, stats.lock_acquisitions);
+		ck_assert(stats.lock_contended <= stats.lock_acquisitions);
+	}
+
+	llist_destroy(listToTest, false, NULL);
+	llist_destroy(plain, false, NULL);
+
+	/* array backed lists count their arrays and report their peak too */
+	listToTest = llist_create_ring(NULL, NULL, 8, FLAG_STATS);
+	for (unsigned long i = 1; i <= 10; i++)
+		llist_add_node(listToTest, (llist_node) i, ADD_NODE_REAR);
+	llist_get_stats(listToTest, &stats);
+	ck_assert_int_eq(stats.allocations, 2);
+	ck_assert_int_eq(stats.peak_size, 10);
+	llist_destroy(listToTest, false, NULL);
+
+	listToTest = llist_create(trivial_comperator, NULL,
+				  FLAG_PRIORITY_QUEUE | FLAG_STATS);
+	for (unsigned long i = 1; i <= 20; i++)
+		llist_push(listToTest, (llist_node) i);
+	llist_get_stats(listToTest, &stats);
+	ck_assert_int_eq(stats.allocations, 2);
+	ck_assert_int_eq(stats.peak_size, 20);
+	llist_destroy(listToTest, false, NULL);
+
+	for (int flags = FLAG_SPSC; flags; flags = (flags == FLAG_SPSC) ?
+	     FLAG_WORK_STEALING : 0) {
+		// the deque owner works on the front, the spsc producer at the rear
+		int add = (flags == FLAG_SPSC) ? ADD_NODE_REAR : ADD_NODE_FRONT;
+
+		listToTest = llist_create_ring(NULL, NULL, 4,
+					       flags | FLAG_STATS);
+		for (unsigned long i = 1; i <= 4; i++)
+			llist_add_node(listToTest, (llist_node) i, add);
+		llist_pop(listToTest);
+		llist_pop(listToTest);
+		llist_add_node(listToTest, (llist_node) 5, add);
+		llist_get_stats(listToTest, &stats);
+		ck_assert_int_eq(stats.allocations, 1);
+		ck_assert_int_eq(stats.peak_size, 4);
+		llist_destroy(listToTest, false, NULL);
+	}
+}
+END_TEST
+
+typedef struct {
+	int begins;
+	int ends;
+	E_LLIST_OP last_op;
+	unsigned long last_count;
+} trace_calls;
+
+void count_trace_begin(E_LLIST_OP op, llist list, void *arg)
+{
+	((trace_calls *) arg)->begins++;
+}
+
+void count_trace_end(E_LLIST_OP op, llist list, unsigned long count,
+		     unsigned long long lock_wait_ns, void *arg)
+{
+	((trace_calls *) arg)->ends++;
+	((trace_calls *) arg)->last_op = op;
+	((trace_calls *) arg)->last_count = count;
+}
+
+START_TEST(llist_29_trace_hooks)
+{
+	int retval, lines = 0;
+	char line[256];
+	llist_node found;
+	trace_calls calls = { 0 };
+	llist_trace_hooks hooks = { count_trace_begin, count_trace_end, &calls };
+	llist_tracer tracer = llist_tracer_create(4);
+	llist listToTest;
+	FILE *file;
+
+	ck_assert_ptr_ne(tracer, NULL);
+
+	retval = llist_set_trace_hooks(&hooks);
+	if (retval == LLIST_NOT_IMPLEMENTED) {
+		/* built without LLIST_TRACE */
+		ck_assert_int_eq(llist_tracer_start(tracer),
+				 LLIST_NOT_IMPLEMENTED);
+		llist_tracer_destroy(tracer);
+		return;
+	}
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+
+	listToTest = llist_create(trivial_comperator, trivial_equal,
+				  test_mt ? FLAG_MT_SUPPORT : 0);
+	for (unsigned long i = 1; i <= 3; i++)
+		llist_add_node(listToTest, (llist_node) i, ADD_NODE_REAR);
+
+	llist_find_node(listToTest, (llist_node) 2, &found);
+	ck_assert_int_eq(calls.begins, 5);
+	ck_assert_int_eq(calls.ends, 5);
+	ck_assert_int_eq(calls.last_op, LLIST_OP_FIND);
+	ck_assert_int_eq(calls.last_count, 2);
+
+	/* the ring keeps the last calls only */
+	ck_assert_int_eq(llist_tracer_start(tracer), LLIST_SUCCESS);
+	for (unsigned long i = 4; i <= 8; i++)
+		llist_add_node(listToTest, (llist_node) i, ADD_NODE_REAR);
+	llist_reverse(listToTest);
+	ck_assert_int_eq(llist_tracer_stop(tracer), LLIST_SUCCESS);
+	ck_assert_int_eq(calls.ends, 5);
+
+	file = tmpfile();
+	ck_assert_int_eq(llist_tracer_dump(tracer, file), LLIST_SUCCESS);
+	rewind(file);
+	while (fgets(line, sizeof(line), file))
+		lines++;
+	ck_assert_int_eq(lines, 5);
+	ck_assert_ptr_ne(strstr(line, "restructure"), NULL);
+	fclose(file);
+
+	/* the reclaimer calls are traced once each, without nested events */
+	llist_destroy(listToTest, false, NULL);
+	if (test_mt) {
+		listToTest = llist_create(trivial_comperator, trivial_equal,
+					  FLAG_MT_SUPPORT |
+					  FLAG_DEFERRED_RECLAIM);
+		llist_add_node(listToTest, (llist_node) 1, ADD_NODE_REAR);
+		llist_delete_node(listToTest, (llist_node) 1, false, NULL);
+
+		llist_set_trace_hooks(&hooks);
+		calls.begins = calls.ends = 0;
+		ck_assert_int_eq(llist_reclaimer_start(listToTest, 60000),
+				 LLIST_SUCCESS);
+		ck_assert_int_eq(llist_reclaimer_stop(listToTest),
+				 LLIST_SUCCESS);
+		llist_destroy(listToTest, false, NULL);
+		ck_assert_int_eq(calls.begins, 3);
+		ck_assert_int_eq(calls.ends, 3);
+		llist_set_trace_hooks(NULL);
+	}
+
+	llist_tracer_destroy(tracer);
+}
+END_TEST
+
+START_TEST(llist_30_serialize)
+{
+	int retval;
+	unsigned long *node;
+	llist_stats stats;
+	llist listToTest = llist_create(ulong_comperator, NULL,
+					test_mt ? FLAG_MT_SUPPORT : 0);
+	llist loaded = llist_create(ulong_comperator, NULL, FLAG_STATS |
+				    (test_mt ? FLAG_MT_SUPPORT : 0));
+	FILE *file = tmpfile();
+
+	for (unsigned long i = 0; i < 1000; i++)
+		llist_add_node(listToTest, new_ulong(i * 7), ADD_NODE_REAR);
+
+	retval = llist_serialize(listToTest, file, ulong_encoder);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+
+	/* loading appends to what's already there */
+	llist_add_node(loaded, new_ulong(12345), ADD_NODE_REAR);
+	rewind(file);
+	retval = llist_deserialize(loaded, file, ulong_decoder, NULL);
+	ck_assert_int_eq(retval, LLIST_SUCCESS);
+	ck_assert_int_eq(llist_size(loaded), 1001);
+
+	node = llist_pop(loaded);
+	ck_assert_int_eq(*node, 12345);
+	free(node);
+
+	for (unsigned long i = 0; i < 1000; i++) {
+		node = llist_pop(loaded);
+		ck_assert_int_eq(*node, i * 7);
+		free(node);
+	}
+
+	/* one allocation for the first node, one for the whole load */
+	llist_get_stats(loaded, &stats);
+	ck_assert_int_eq(stats.allocations, 2);
+
+	/* an empty list round trips too */
+	rewind(file);
+	llist_serialize(loaded, file, ulong_encoder);
+	rewind(file);
+	ck_assert_int_eq(llist_deserialize(loaded, file, ulong_decoder, NULL),
+			 LLIST_SUCCESS);
+	ck_assert_int_eq(llist_size(loaded), 0);
+
+	/* a truncated file is rejected and the list is left alone */
+	fclose(file);
+	file = tmpfile();
+	llist_serialize(listToTest, file, ulong_encoder);
+	ck_assert_int_eq(ftruncate(fileno(file), ftell(file) - 3), 0);
+	rewind(file);
+	retval = llist_deserialize(loaded, file, ulong_decoder, NULL);
+	ck_assert_int_eq(retval, LLIST_ERROR);
+	ck_assert_int_eq(llist_size(loaded), 0);
+
+	/* a corrupt count fails on the missing records, not on malloc */
+	rewind(file);
+	fwrite("LLST\1\0\0\0\xff\xff\xff\xff\0\0\0\0", 16, 1, file);
+	rewind(file);
+	retval = llist_deserialize(loaded, file, ulong_decoder, NULL);
+	ck_assert_int_eq(retval, LLIST_ERROR);
+	ck_assert_int_eq(llist_size(loaded), 0);
+
+	/* a bogus record length fails on the missing bytes too */
+	rewind(file);
+	fwrite("LLST\1\0\0\0\1\0\0\0\0\0\0\0\xf0\xff\xff\xff", 20, 1,
+	       file);
+	fflush(file);
+	ck_assert_int_eq(ftruncate(fileno(file), 64), 0);
+	rewind(file);
+	retval = llist_deserialize(loaded, file, ulong_decoder, NULL);
+	ck_assert_int_eq(retval, LLIST_ERROR);
+	ck_assert_int_eq(llist_size(loaded), 0);
+
+	/* and the list count can't overflow */
+	llist_add_node(loaded, new_ulong(1), ADD_NODE_REAR);
+	rewind(file);
+	fwrite("LLST\1\0\0\0\xff\xff\xff\xff\0\0\0\0", 16, 1, file);
+	rewind(file);
+	retval = llist_deserialize(loaded, file, ulong_decoder, NULL);
+	ck_assert_int_eq(retval, LLIST_ERROR);
+	ck_assert_int_eq(llist_size(loaded), 1);
+
+	/* so is something that isn't a list at all */
+	rewind(file);
+	fputs("not a list, not a list", file);
+	rewind(file);
+	retval = llist_deserialize(loaded, file, ulong_decoder, NULL);
+	ck_assert_int_eq(retval, LLIST_ERROR);
+
+	fclose(file);
+	llist_destroy(listToTest, true, NULL);
+	llist_destroy(loaded, true, NULL);
+}
+END_TEST
+
+void sum_encoded_ulong(const void *data, size_t len, void *arg)
+{
+	unsigned long value;
+
+	memcpy(&value, data, sizeof(value));
+	*(unsigned long *) arg += value;
+}
+
+START_TEST(llist_31_persistent_list)
+{
+	char path[] = "/tmp/llist_test_XXXXXX";
+	unsigned long value, sum = 0;
+	unsigned long *node;
+	size_t len;
+	struct stat before, after;
+	int fd = mkstemp(path);
+	pllist list;
+
+	ck_assert(fd >= 0);
+	close(fd);
+
+	list = pllist_open(path, test_mt ? FLAG_MT_SUPPORT : 0);
+	ck_assert_ptr_ne(list, NULL);
+	ck_assert(pllist_is_empty(list));
+	ck_assert_ptr_eq(pllist_pop(list, ulong_decoder), NULL);
+
+	/* enough nodes to grow the file a few times */
+	for (unsigned long i = 1; i <= 10000; i++) {
+		value = i;
+		ck_assert_int_eq(pllist_add_node(list, &value, ulong_encoder,
+						 ADD_NODE_REAR), LLIST_SUCCESS);
+	}
+	value = 0;
+	pllist_push(list, &value, ulong_encoder);
+	ck_assert_int_eq(pllist_close(list), LLIST_SUCCESS);
+
+	/* the next run finds everything where it was */
+	list = pllist_open(path, test_mt ? FLAG_MT_SUPPORT : 0);
+	ck_assert_ptr_ne(list, NULL);
+	ck_assert_int_eq(pllist_size(list), 10001);
+
+	memcpy(&value, pllist_peek(list, &len), sizeof(value));
+	ck_assert_int_eq(len, sizeof(unsigned long));
+	ck_assert_int_eq(value, 0);
+	memcpy(&value, pllist_get_tail(list, NULL), sizeof(value));
+	ck_assert_int_eq(value, 10000);
+
+	pllist_for_each(list, sum_encoded_ulong, &sum);
+	ck_assert_int_eq(sum, 10000UL * 10001 / 2);
+
+	for (unsigned long i = 0; i <= 5000; i++) {
+		node = pllist_pop(list, ulong_decoder);
+		ck_assert_int_eq(*node, i);
+		free(node);
+	}
+
+	/* popped space is reused instead of growing the file */
+	stat(path, &before);
+	for (unsigned long i = 0; i < 5000; i++) {
+		value = 20000 + i;
+		pllist_add_node(list, &value, ulong_encoder, ADD_NODE_REAR);
+	}
+	ck_assert_int_eq(pllist_size(list), 10000);
+	pllist_close(list);
+
+	stat(path, &after);
+	ck_assert_int_eq(after.st_size, before.st_size);
+
+	/* something that isn't a list can't be opened */
+	fd = open(path, O_WRONLY | O_TRUNC);
+	ck_assert_int_eq(write(fd, "garbage, not a persistent list", 30), 30);
+	close(fd);
+	ck_assert_ptr_eq(pllist_open(path, 0), NULL);
+
+	unlink(path);
+}
+END_TEST
+
+START_TEST(llist_32_shared_memory_list)
+{
+	size_t size = shllist_region_size(16, sizeof(unsigned long));
+	void *region = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	unsigned long *slot, sum = 0, expected = 0;
+	int status;
+	pid_t child;
+	shllist list;
+
+	ck_assert(region != MAP_FAILED);
+	ck_assert_ptr_eq(shllist_create(region, size - 1, 16,
+					sizeof(unsigned long)), NULL);
+	ck_assert_ptr_eq(shllist_attach(region), NULL);
+
+	list = shllist_create(region, size, 16, sizeof(unsigned long));
+	ck_assert_ptr_ne(list, NULL);
+	ck_assert_int_eq(shllist_slot_size(list), sizeof(unsigned long));
+
+	/* the pool is bounded */
+	for (int i = 0; i < 16; i++) {
+		slot = shllist_alloc(list);
+		ck_assert_ptr_ne(slot, NULL);
+		*slot = i;
+		shllist_add_node(list, slot, ADD_NODE_REAR);
+	}
+	ck_assert_ptr_eq(shllist_alloc(list), NULL);
+	ck_assert_int_eq(*(unsigned long *) shllist_get_tail(list), 15);
+
+	unsigned long local = 0;
+	ck_assert_int_eq(shllist_add_node(list, &local, ADD_NODE_REAR),
+			 LLIST_ERROR);
+
+	while ((slot = shllist_pop(list)) != NULL)
+		shllist_free(list, slot);
+	ck_assert(shllist_is_empty(list));
+
+	/* another process produces, this one consumes */
+	child = fork();
+	ck_assert(child >= 0);
+	if (child == 0) {
+		shllist shared = shllist_attach(region);
+
+		for (unsigned long i = 1; i <= 1000; i++) {
+			while ((slot = shllist_alloc(shared)) == NULL)
+				sched_yield();
+
+			*slot = i;
+			shllist_add_node(shared, slot, ADD_NODE_REAR);
+		}
+		_exit(0);
+	}
+
+	for (unsigned long i = 1; i <= 1000; i++) {
+		while ((slot = shllist_pop(list)) == NULL)
+			sched_yield();
+
+		/* items come out in the order they were produced */
+		ck_assert_int_eq(*slot, i);
+		sum += *slot;
+		expected += i;
+		shllist_free(list, slot);
+	}
+
+	waitpid(child, &status, 0);
+	ck_assert(WIFEXITED(status) && (WEXITSTATUS(status) == 0));
+	ck_assert_int_eq(sum, expected);
+	ck_assert(shllist_is_empty(list));
+
+	shllist_destroy(list);
+	munmap(region, size);
+}
+END_TEST
+
+void check_values(llist list, const unsigned long *expected, int count)
+{
+	ck_assert_int_eq(llist_size(list), count);
+
+	for (int i = 0; i < count; i++) {
+		llist_node node = llist_pop(list);
+
+		ck_assert_int_eq((unsigned long) node, expected[i]);
+		llist_add_node(list, node, ADD_NODE_REAR);
+	}
+
+	if (count)
+		ck_assert_int_eq((unsigned long) llist_get_tail(list),
+				 expected[count - 1]);
+}
+
+START_TEST(llist_33_split_splice_partition)
+{
+	int flags = FLAG_STATS | (test_mt ? FLAG_MT_SUPPORT : 0);
+	llist listToTest = llist_create(trivial_comperator, trivial_equal, flags);
+	llist other = llist_create(trivial_comperator, trivial_equal, flags);
+	llist odd = llist_create(trivial_comperator, trivial_equal, flags);
+	llist stats_list[] = { listToTest, other, odd };
+	llist_stats stats;
+
+	for (unsigned long i = 1; i <= 10; i++)
+		llist_add_node(listToTest, (llist_node) i, ADD_NODE_REAR);
+
+	/* split */
+	ck_assert_int_eq(llist_split_at(listToTest, 11, other),
+			 LLIST_NODE_NOT_FOUND);
+	ck_assert_int_eq(llist_split_at(listToTest, 3, listToTest), LLIST_ERROR);
+	ck_assert_int_eq(llist_split_at(listToTest, 7, other), LLIST_SUCCESS);
+	check_values(listToTest, (unsigned long []) { 1, 2, 3, 4, 5, 6, 7 }, 7);
+	check_values(other, (unsigned long []) { 8, 9, 10 }, 3);
+
+	ck_assert_int_eq(llist_split_at(listToTest, 7, other), LLIST_SUCCESS);
+	ck_assert_int_eq(llist_size(other), 3);
+
+	/* splice a run from the middle after a given node */
+	ck_assert_int_eq(llist_splice(other, (llist_node) 8, listToTest,
+				      (llist_node) 3, (llist_node) 5),
+			 LLIST_SUCCESS);
+	check_values(listToTest, (unsigned long []) { 1, 2, 6, 7 }, 4);
+	check_values(other, (unsigned long []) { 8, 3, 4, 5, 9, 10 }, 6);
+
+	/* to before from, or missing nodes, leave both lists alone */
+	ck_assert_int_eq(llist_splice(other, NULL, listToTest,
+				      (llist_node) 7, (llist_node) 6),
+			 LLIST_NODE_NOT_FOUND);
+	ck_assert_int_eq(llist_splice(other, (llist_node) 42, listToTest,
+				      NULL, NULL), LLIST_NODE_NOT_FOUND);
+	ck_assert_int_eq(llist_splice(other, NULL, other, NULL, NULL),
+			 LLIST_ERROR);
+
+	/* front of dest, tail of src */
+	ck_assert_int_eq(llist_splice(other, NULL, listToTest,
+				      (llist_node) 6, NULL), LLIST_SUCCESS);
+	check_values(listToTest, (unsigned long []) { 1, 2 }, 2);
+	check_values(other, (unsigned long []) { 6, 7, 8, 3, 4, 5, 9, 10 }, 8);
+
+	/* the whole source after the tail of dest */
+	ck_assert_int_eq(llist_splice(other, (llist_node) 10, listToTest,
+				      NULL, NULL), LLIST_SUCCESS);
+	ck_assert(llist_is_empty(listToTest));
+	check_values(other,
+		     (unsigned long []) { 6, 7, 8, 3, 4, 5, 9, 10, 1, 2 }, 10);
+
+	/* partition keeps the order on both sides */
+	ck_assert_int_eq(llist_partition(other, is_multiple_of, (void *) 2,
+					 listToTest, listToTest), LLIST_ERROR);
+	ck_assert_int_eq(llist_partition(other, is_multiple_of, (void *) 2,
+					 listToTest, odd), LLIST_SUCCESS);
+	ck_assert(llist_is_empty(other));
+	check_values(listToTest, (unsigned long []) { 6, 8, 4, 10, 2 }, 5);
+	check_values(odd, (unsigned long []) { 7, 3, 5, 9, 1 }, 5);
+
+	/* nothing was allocated by any of the above but check_values() */
+	for (int i = 0; i < 3; i++) {
+		llist_get_stats(stats_list[i], &stats);
+		ck_assert_int_eq(stats.allocations,
+				 stats.ops[LLIST_OP_ADD]);
+	}
+
+	llist_destroy(listToTest, false, NULL);
+	llist_destroy(other, false, NULL);
+	llist_destroy(odd, false, NULL);
+}
+END_TEST
+
+START_TEST(llist_34_positional_access)
+{
+	int base = test_mt ? FLAG_MT_SUPPORT : 0;
+	int flags[] = { base, base | FLAG_POSITIONAL_INDEX | FLAG_STATS };
+	unsigned long model[1024];
+	unsigned int size, pos;
+	llist_stats stats;
+	llist_node node;
+
+	for (int f = 0; f < 2; f++) {
+		llist listToTest = llist_create(trivial_comperator,
+						trivial_equal, flags[f]);
+
+		size = 0;
+		srand(f + 1);
+
+		ck_assert_int_eq(llist_get_at(listToTest, 0, &node),
+				 LLIST_NODE_NOT_FOUND);
+		ck_assert_int_eq(llist_insert_at(listToTest, 1, (llist_node) 1),
+				 LLIST_NODE_NOT_FOUND);
+		ck_assert_int_eq(llist_delete_at(listToTest, 0, false, NULL),
+				 LLIST_NODE_NOT_FOUND);
+
+		// random positional inserts and deletes, checked against an array
+		for (unsigned long i = 1; i <= 3000; i++) {
+			if ((size < 1000) && ((size < 500) || (rand() % 3))) {
+				pos = rand() % (size + 1);
+				ck_assert_int_eq(llist_insert_at(listToTest, pos,
+								 (llist_node) i),
+						 LLIST_SUCCESS);
+				memmove(&model[pos + 1], &model[pos],
+					(size - pos) * sizeof(model[0]));
+				model[pos] = i;
+				size++;
+			} else {
+				pos = rand() % size;
+				ck_assert_int_eq(llist_delete_at(listToTest, pos,
+								 false, NULL),
+						 LLIST_SUCCESS);
+				memmove(&model[pos], &model[pos + 1],
+					(size - pos - 1) * sizeof(model[0]));
+				size--;
+			}
+
+			// queue operations keep the index too
+			if ((i % 100) == 0) {
+				llist_add_node(listToTest, (llist_node) i,
+					       ADD_NODE_REAR);
+				model[size++] = i;
+				ck_assert_int_eq((unsigned long) llist_pop(listToTest),
+						 model[0]);
+				memmove(&model[0], &model[1],
+					--size * sizeof(model[0]));
+			}
+
+			pos = rand() % size;
+			ck_assert_int_eq(llist_get_at(listToTest, pos, &node),
+					 LLIST_SUCCESS);
+			ck_assert_int_eq((unsigned long) node, model[pos]);
+		}
+
+		ck_assert_int_eq(llist_size(listToTest), size);
+		ck_assert_int_eq((unsigned long) llist_get_head(listToTest),
+				 model[0]);
+		ck_assert_int_eq((unsigned long) llist_get_tail(listToTest),
+				 model[size - 1]);
+		for (pos = 0; pos < size; pos++) {
+			ck_assert_int_eq(llist_get_at(listToTest, pos, &node),
+					 LLIST_SUCCESS);
+			ck_assert_int_eq((unsigned long) node, model[pos]);
+		}
+		ck_assert_int_eq(llist_get_at(listToTest, size, &node),
+				 LLIST_NODE_NOT_FOUND);
+
+		// any other change drops the index, the next lookup rebuilds it
+		ck_assert_int_eq(llist_reverse(listToTest), LLIST_SUCCESS);
+		ck_assert_int_eq(llist_get_at(listToTest, 0, &node),
+				 LLIST_SUCCESS);
+		ck_assert_int_eq((unsigned long) node, model[size - 1]);
+		ck_assert_int_eq(llist_get_at(listToTest, size - 1, &node),
+				 LLIST_SUCCESS);
+		ck_assert_int_eq((unsigned long) node, model[0]);
+
+		if (flags[f] & FLAG_STATS) {
+			// no lookup should have walked anywhere near the whole list
+			llist_get_stats(listToTest, &stats);
+			ck_assert(stats.scanned[LLIST_OP_READ] <
+				  stats.ops[LLIST_OP_READ] * 64);
+		}
+
+		llist_destroy(listToTest, false, NULL);
+	}
+}
+END_TEST
+
+unsigned long reclaimed_sum, reclaimed_other;
+
+void reclaim_destructor(llist_node node)
+{
+	__atomic_add_fetch(&reclaimed_sum, (unsigned long) node,
+			   __ATOMIC_RELAXED);
+}
+
+void reclaim_other_destructor(llist_node node)
+{
+	__atomic_add_fetch(&reclaimed_other, 1, __ATOMIC_RELAXED);
+}
+
+START_TEST(llist_35_deferred_reclaim)
+{
+	int flags = FLAG_DEFERRED_RECLAIM | (test_mt ? FLAG_MT_SUPPORT : 0);
+	llist listToTest = llist_create(trivial_comperator, trivial_equal, flags);
+	llist plain = llist_create(trivial_comperator, trivial_equal, 0);
+	llist_iter iter;
+	llist_node node;
+
+	reclaimed_sum = reclaimed_other = 0;
+
+	for (unsigned long i = 1; i <= 10; i++)
+		llist_add_node(listToTest, (llist_node) i, ADD_NODE_REAR);
+
+	// deletions only unlink, the destructors wait for llist_reclaim()
+	ck_assert_int_eq(llist_delete_node(listToTest, (llist_node) 1, true,
+					   reclaim_destructor), LLIST_SUCCESS);
+	ck_assert_int_eq(llist_delete_node(listToTest, (llist_node) 5, true,
+					   reclaim_destructor), LLIST_SUCCESS);
+	ck_assert_int_eq(llist_remove_if(listToTest, is_multiple_of,
+					 (void *) 3, true, reclaim_destructor),
+			 LLIST_SUCCESS);
+	ck_assert_int_eq(llist_delete_node(listToTest, (llist_node) 2, true,
+					   reclaim_other_destructor),
+			 LLIST_SUCCESS);
+	ck_assert_int_eq((unsigned long) llist_pop(listToTest), 4);
+
+	llist_iter_begin(listToTest, &iter, 0);
+	while (llist_iter_next(&iter, &node) == LLIST_SUCCESS)
+		if ((unsigned long) node == 10)
+			llist_iter_remove(&iter, true, reclaim_destructor);
+	llist_iter_end(&iter);
+
+	ck_assert_int_eq(llist_size(listToTest), 2);
+	ck_assert_int_eq(reclaimed_sum, 0);
+	ck_assert_int_eq(reclaimed_other, 0);
+
+	ck_assert_int_eq(llist_reclaim(listToTest), LLIST_SUCCESS);
+	ck_assert_int_eq(reclaimed_sum, 1 + 5 + 3 + 6 + 9 + 10);
+	ck_assert_int_eq(reclaimed_other, 1);
+
+	ck_assert_int_eq(llist_reclaim(listToTest), LLIST_SUCCESS);
+	ck_assert_int_eq(reclaimed_sum, 1 + 5 + 3 + 6 + 9 + 10);
+
+	// the reclaimer thread needs a thread safe list
+	ck_assert_int_eq(llist_reclaimer_start(plain, 10), LLIST_ERROR);
+	ck_assert_int_eq(llist_reclaim(plain), LLIST_SUCCESS);
+
+	if (test_mt) {
+		reclaimed_sum = 0;
+		ck_assert_int_eq(llist_reclaimer_start(listToTest, 10),
+				 LLIST_SUCCESS);
+		ck_assert_int_eq(llist_reclaimer_start(listToTest, 10),
+				 LLIST_ERROR);
+
+		for (unsigned long i = 0; i < 1000; i++) {
+			llist_add_node(listToTest, (llist_node) 1, ADD_NODE_REAR);
+			llist_delete_node(listToTest, (llist_node) 1, true,
+					  reclaim_destructor);
+		}
+
+		for (int i = 0; (i < 500) &&
+		     (__atomic_load_n(&reclaimed_sum, __ATOMIC_RELAXED) < 1000);
+		     i++)
+			usleep(10000);
+		ck_assert_int_eq(__atomic_load_n(&reclaimed_sum,
+						 __ATOMIC_RELAXED), 1000);
+
+		ck_assert_int_eq(llist_reclaimer_stop(listToTest),
+				 LLIST_SUCCESS);
+
+		// a full batch (256 by default) wakes the reclaimer up early
+		reclaimed_sum = 0;
+		ck_assert_int_eq(llist_reclaimer_start(listToTest, 60000),
+				 LLIST_SUCCESS);
+
+		for (unsigned long i = 0; i < 256; i++) {
+			llist_add_node(listToTest, (llist_node) 1, ADD_NODE_REAR);
+			llist_delete_node(listToTest, (llist_node) 1, true,
+					  reclaim_destructor);
+		}
+
+		for (int i = 0; (i < 500) &&
+		     (__atomic_load_n(&reclaimed_sum, __ATOMIC_RELAXED) < 256);
+		     i++)
+			usleep(10000);
+		ck_assert_int_eq(__atomic_load_n(&reclaimed_sum,
+						 __ATOMIC_RELAXED), 256);
+
+		ck_assert_int_eq(llist_reclaimer_stop(listToTest),
+				 LLIST_SUCCESS);
+	}
+
+	// whatever is still queued goes with the list
+	reclaimed_sum = 0;
+	llist_delete_node(listToTest, (llist_node) 7, true, reclaim_destructor);
+	llist_destroy(listToTest, false, NULL);
+	ck_assert_int_eq(reclaimed_sum, 7);
+	llist_destroy(plain, false, NULL);
+}
+END_TEST
+
+START_TEST(llist_36_clear)
+{
+	int flags = test_mt ? FLAG_MT_SUPPORT : 0;
+	llist listToTest = llist_create(trivial_comperator, trivial_equal, flags);
+	llist deferred = llist_create(trivial_comperator, trivial_equal,
+				      flags | FLAG_DEFERRED_RECLAIM);
+
+	ck_assert_int_eq(llist_clear(NULL, false, NULL), LLIST_NULL_ARGUMENT);
+	ck_assert_int_eq(llist_clear(listToTest, true, NULL), LLIST_SUCCESS);
+
+	// free() is the default destructor, leak checkers catch a miss
+	for (int i = 0; i < 100; i++)
+		llist_add_node(listToTest, malloc(16), ADD_NODE_REAR);
+	ck_assert_int_eq(llist_clear(listToTest, true, NULL), LLIST_SUCCESS);
+	ck_assert(llist_is_empty(listToTest));
+	ck_assert(llist_get_head(listToTest) == NULL);
+	ck_assert(llist_get_tail(listToTest) == NULL);
+
+	// the list is still usable
+	for (unsigned long i = 1; i <= 3; i++)
+		llist_add_node(listToTest, (llist_node) i, ADD_NODE_REAR);
+	ck_assert_int_eq(llist_size(listToTest), 3);
+	ck_assert_int_eq((unsigned long) llist_get_head(listToTest), 1);
+	ck_assert_int_eq((unsigned long) llist_get_tail(listToTest), 3);
+
+	// deferred lists hand the nodes to the reclaimer
+	reclaimed_sum = 0;
+	for (unsigned long i = 1; i <= 10; i++)
+		llist_add_node(deferred, (llist_node) i, ADD_NODE_REAR);
+	llist_delete_node(deferred, (llist_node) 10, true, reclaim_destructor);
+	ck_assert_int_eq(llist_clear(deferred, true, reclaim_destructor),
+			 LLIST_SUCCESS);
+	ck_assert(llist_is_empty(deferred));
+	ck_assert_int_eq(reclaimed_sum, 0);
+	ck_assert_int_eq(llist_reclaim(deferred), LLIST_SUCCESS);
+	ck_assert_int_eq(reclaimed_sum, 55);
+
+	llist_add_node(deferred, (llist_node) 1, ADD_NODE_FRONT);
+	ck_assert_int_eq((unsigned long) llist_get_tail(deferred), 1);
+
+	llist_destroy(listToTest, false, NULL);
+	llist_destroy(deferred, false, NULL);
+}
+END_TEST
+
+START_TEST(llist_37_ring)
+{
+	int flags = FLAG_STATS | (test_mt ? FLAG_MT_SUPPORT : 0);
+	llist ring = llist_create_ring(trivial_comperator, trivial_equal, 4,
+				       flags);
+	llist bounded = llist_create_ring(trivial_comperator, trivial_equal, 4,
+					  flags | FLAG_RING_BOUNDED);
+	unsigned long sum = 0;
+	llist_stats stats;
+	llist_node node;
+
+	ck_assert(llist_create_ring(trivial_comperator, trivial_equal, 0,
+				    flags) == NULL);
+	ck_assert(llist_pop(ring) == NULL);
+	ck_assert(llist_get_head(ring) == NULL);
+	ck_assert(llist_get_tail(ring) == NULL);
+
+	// growable: both ends, across several doublings
+	for (unsigned long i = 1; i <= 50; i++) {
+		ck_assert_int_eq(llist_add_node(ring, (llist_node) (100 + i),
+						ADD_NODE_REAR), LLIST_SUCCESS);
+		ck_assert_int_eq(llist_push(ring, (llist_node) (100 - i)),
+				 LLIST_SUCCESS);
+	}
+	ck_assert_int_eq(llist_size(ring), 100);
+	ck_assert_int_eq((unsigned long) llist_peek(ring), 50);
+	ck_assert_int_eq((unsigned long) llist_get_tail(ring), 150);
+	ck_assert_int_eq(llist_get_at(ring, 49, &node), LLIST_SUCCESS);
+	ck_assert_int_eq((unsigned long) node, 99);
+	ck_assert_int_eq(llist_get_at(ring, 50, &node), LLIST_SUCCESS);
+	ck_assert_int_eq((unsigned long) node, 101);
+	ck_assert_int_eq(llist_get_at(ring, 100, &node), LLIST_NODE_NOT_FOUND);
+
+	llist_for_each_arg(ring, sum_node_func, &sum);
+	ck_assert_int_eq(sum, 100 * 100);
+
+	for (unsigned long i = 50; i <= 150; i++)
+		if (i != 100)
+			ck_assert_int_eq((unsigned long) llist_pop(ring), i);
+	ck_assert(llist_is_empty(ring));
+
+	// bounded: refuses to grow, keeps working across the wrap
+	for (unsigned long i = 1; i <= 4; i++)
+		llist_add_node(bounded, (llist_node) i, ADD_NODE_REAR);
+	ck_assert_int_eq(llist_add_node(bounded, (llist_node) 5, ADD_NODE_REAR),
+			 LLIST_FULL);
+	ck_assert_int_eq(llist_push(bounded, (llist_node) 5), LLIST_FULL);
+	ck_assert_int_eq((unsigned long) llist_pop(bounded), 1);
+	ck_assert_int_eq((unsigned long) llist_pop(bounded), 2);
+	llist_add_node(bounded, (llist_node) 5, ADD_NODE_REAR);
+	llist_add_node(bounded, (llist_node) 6, ADD_NODE_REAR);
+	check_values(bounded, (unsigned long []) { 3, 4, 5, 6 }, 4);
+
+	// only the queue calls are supported
+	ck_assert_int_eq(llist_sort(ring, SORT_LIST_ASCENDING),
+			 LLIST_NOT_IMPLEMENTED);
+	ck_assert_int_eq(llist_delete_node(bounded, (llist_node) 3, false, NULL),
+			 LLIST_NOT_IMPLEMENTED);
+	ck_assert_int_eq(llist_find_node(bounded, (llist_node) 3, &node),
+			 LLIST_NOT_IMPLEMENTED);
+	ck_assert_int_eq(llist_get_max(bounded, &node), LLIST_NOT_IMPLEMENTED);
+	ck_assert_int_eq(llist_concat(ring, bounded), LLIST_NOT_IMPLEMENTED);
+
+	// no allocation per node, only the array and its doublings
+	llist_get_stats(ring, &stats);
+	ck_assert_int_eq(stats.allocations, 6);
+	ck_assert_int_eq(stats.peak_size, 100);
+
+	// clear and destroy run the destructor on what is left
+	for (int i = 0; i < 10; i++)
+		llist_add_node(ring, malloc(16), ADD_NODE_FRONT);
+	ck_assert_int_eq(llist_clear(ring, true, NULL), LLIST_SUCCESS);
+	ck_assert(llist_is_empty(ring));
+	for (int i = 0; i < 10; i++)
+		llist_add_node(ring, malloc(16), ADD_NODE_REAR);
+
+	llist_destroy(ring, true, NULL);
+	llist_destroy(bounded, false, NULL);
+}
+END_TEST
+
+#define SPSC_ITEMS 1000000UL
+
+void *spsc_producer(void *arg)
+{
+	for (unsigned long i = 1; i <= SPSC_ITEMS; i++)
+		while (llist_add_node(arg, (llist_node) i, ADD_NODE_REAR) ==
+		       LLIST_FULL)
+			sched_yield();
+
+	return NULL;
+}
+
+START_TEST(llist_38_spsc_queue)
+{
+	llist queue = llist_create_ring(trivial_comperator, trivial_equal, 5,
+					FLAG_SPSC);
+	llist_node node;
+	pthread_t producer;
+
+	ck_assert(llist_pop(queue) == NULL);
+	ck_assert(llist_peek(queue) == NULL);
+	ck_assert(llist_get_tail(queue) == NULL);
+	ck_assert_int_eq(llist_push(queue, (llist_node) 1),
+			 LLIST_NOT_IMPLEMENTED);
+
+	// the capacity is exact, even if the array is a power of two
+	for (unsigned long i = 1; i <= 5; i++)
+		ck_assert_int_eq(llist_add_node(queue, (llist_node) i,
+						ADD_NODE_REAR), LLIST_SUCCESS);
+	ck_assert_int_eq(llist_add_node(queue, (llist_node) 6, ADD_NODE_REAR),
+			 LLIST_FULL);
+	ck_assert_int_eq(llist_size(queue), 5);
+	ck_assert_int_eq((unsigned long) llist_peek(queue), 1);
+	ck_assert_int_eq((unsigned long) llist_get_tail(queue), 5);
+
+	ck_assert_int_eq(llist_get_at(queue, 0, &node), LLIST_NOT_IMPLEMENTED);
+	ck_assert_int_eq(llist_for_each(queue, trivial_node_func),
+			 LLIST_NOT_IMPLEMENTED);
+	ck_assert_int_eq(llist_sort(queue, SORT_LIST_ASCENDING),
+			 LLIST_NOT_IMPLEMENTED);
+
+	for (unsigned long i = 1; i <= 5; i++)
+		ck_assert_int_eq((unsigned long) llist_pop(queue), i);
+	ck_assert(llist_is_empty(queue));
+
+	// one producer and one consumer thread, FIFO order end to end
+	if (test_mt) {
+		unsigned long expected = 1;
+
+		pthread_create(&producer, NULL, spsc_producer, queue);
+		while (expected <= SPSC_ITEMS) {
+			node = llist_pop(queue);
+			if (node == NULL) {
+				sched_yield();
+				continue;
+			}
+			ck_assert_int_eq((unsigned long) node, expected);
+			expected++;
+		}
+		pthread_join(producer, NULL);
+		ck_assert(llist_is_empty(queue));
+	}
+
+	// destroy runs the destructor on what is still queued
+	for (int i = 0; i < 3; i++)
+		llist_add_node(queue, malloc(16), ADD_NODE_REAR);
+	llist_destroy(queue, true, NULL);
+}
+END_TEST
+
+#define STEAL_ITEMS 200000UL
+#define STEAL_THIEVES 3
+
+unsigned char steal_seen[STEAL_ITEMS + 1];
+bool steal_done;
+
+void *steal_thief(void *arg)
+{
+	llist_node node;
+
+	while (!__atomic_load_n(&steal_done, __ATOMIC_ACQUIRE) ||
+	       !llist_is_empty(arg)) {
+		if (llist_steal(arg, &node) == LLIST_SUCCESS)
+			__atomic_add_fetch(&steal_seen[(unsigned long) node], 1,
+					   __ATOMIC_RELAXED);
+	}
+
+	return NULL;
+}
+
+START_TEST(llist_39_work_stealing)
+{
+	llist deque = llist_create_ring(trivial_comperator, trivial_equal, 4,
+					FLAG_WORK_STEALING);
+	llist plain = llist_create(trivial_comperator, trivial_equal, 0);
+	pthread_t thieves[STEAL_THIEVES];
+	llist_node node;
+
+	ck_assert(llist_create_ring(trivial_comperator, trivial_equal, 4,
+				    FLAG_WORK_STEALING | FLAG_SPSC) == NULL);
+	ck_assert(llist_pop(deque) == NULL);
+	ck_assert_int_eq(llist_steal(deque, &node), LLIST_NODE_NOT_FOUND);
+	ck_assert_int_eq(llist_steal(plain, &node), LLIST_NOT_IMPLEMENTED);
+	ck_assert_int_eq(llist_add_node(deque, (llist_node) 1, ADD_NODE_REAR),
+			 LLIST_NOT_IMPLEMENTED);
+
+	// the owner works LIFO, thieves take the oldest, across growths
+	for (unsigned long i = 1; i <= 100; i++)
+		ck_assert_int_eq(llist_push(deque, (llist_node) i),
+				 LLIST_SUCCESS);
+	ck_assert_int_eq(llist_size(deque), 100);
+	ck_assert_int_eq((unsigned long) llist_pop(deque), 100);
+	ck_assert_int_eq(llist_steal(deque, &node), LLIST_SUCCESS);
+	ck_assert_int_eq((unsigned long) node, 1);
+	ck_assert_int_eq(llist_steal(deque, &node), LLIST_SUCCESS);
+	ck_assert_int_eq((unsigned long) node, 2);
+	for (unsigned long i = 99; i >= 3; i--)
+		ck_assert_int_eq((unsigned long) llist_pop(deque), i);
+	ck_assert(llist_is_empty(deque));
+	ck_assert_int_eq(llist_for_each(deque, trivial_node_func),
+			 LLIST_NOT_IMPLEMENTED);
+
+	// every node is taken exactly once, by the owner or a thief
+	if (test_mt) {
+		memset(steal_seen, 0, sizeof(steal_seen));
+		steal_done = false;
+
+		for (int i = 0; i < STEAL_THIEVES; i++)
+			pthread_create(&thieves[i], NULL, steal_thief, deque);
+
+		for (unsigned long i = 1; i <= STEAL_ITEMS; i++) {
+			llist_push(deque, (llist_node) i);
+			if ((i % 3) == 0) {
+				node = llist_pop(deque);
+				if (node)
+					steal_seen[(unsigned long) node]++;
+			}
+		}
+		__atomic_store_n(&steal_done, true, __ATOMIC_RELEASE);
+
+		while ((node = llist_pop(deque)) != NULL)
+			__atomic_add_fetch(&steal_seen[(unsigned long) node], 1,
+					   __ATOMIC_RELAXED);
+
+		for (int i = 0; i < STEAL_THIEVES; i++)
+			pthread_join(thieves[i], NULL);
+
+		for (unsigned long i = 1; i <= STEAL_ITEMS; i++)
+			ck_assert_int_eq(steal_seen[i], 1);
+	}
+
+	for (int i = 0; i < 10; i++)
+		llist_push(deque, malloc(16));
+	free(llist_pop(deque));
+	ck_assert_int_eq(llist_steal(deque, &node), LLIST_SUCCESS);
+	free(node);
+	llist_destroy(deque, true, NULL);
+	llist_destroy(plain, false, NULL);
+}
+END_TEST
+
+START_TEST(llist_40_priority_queue)
+{
+	int flags = FLAG_PRIORITY_QUEUE | (test_mt ? FLAG_MT_SUPPORT : 0);
+	llist minq = llist_create(trivial_comperator, trivial_equal, flags);
+	llist maxq = llist_create(trivial_comperator, trivial_equal,
+				  flags | FLAG_PRIORITY_MAX);
+	unsigned long value, prev, sum = 0, expected = 0;
+	llist_node node;
+
+	ck_assert(llist_create(NULL, trivial_equal, FLAG_PRIORITY_QUEUE) == NULL);
+	ck_assert(llist_pop(minq) == NULL);
+	ck_assert(llist_peek(minq) == NULL);
+
+	srand(7);
+	for (int i = 0; i < 1000; i++) {
+		value = 1 + rand() % 500;   // plenty of duplicates
+		expected += value;
+		ck_assert_int_eq(llist_push(minq, (llist_node) value),
+				 LLIST_SUCCESS);
+		ck_assert_int_eq(llist_add_node(maxq, (llist_node) value,
+						ADD_NODE_REAR), LLIST_SUCCESS);
+	}
+	ck_assert_int_eq(llist_size(minq), 1000);
+
+	llist_for_each_arg(minq, sum_node_func, &sum);
+	ck_assert_int_eq(sum, expected);
+
+	ck_assert(llist_get_tail(minq) == NULL);
+	ck_assert_int_eq(llist_get_at(minq, 0, &node), LLIST_NOT_IMPLEMENTED);
+	ck_assert_int_eq(llist_sort(minq, SORT_LIST_ASCENDING),
+			 LLIST_NOT_IMPLEMENTED);
+
+	// pops come out ordered, peek always shows the next one
+	prev = 0;
+	for (int i = 0; i < 1000; i++) {
+		value = (unsigned long) llist_peek(minq);
+		ck_assert_int_eq((unsigned long) llist_pop(minq), value);
+		ck_assert(value >= prev);
+		prev = value;
+	}
+	ck_assert(llist_is_empty(minq));
+
+	prev = ULONG_MAX;
+	for (int i = 0; i < 500; i++) {
+		value = (unsigned long) llist_pop(maxq);
+		ck_assert(value <= prev);
+		prev = value;
+	}
+	ck_assert_int_eq(llist_clear(maxq, false, NULL), LLIST_SUCCESS);
+	ck_assert(llist_is_empty(maxq));
+
+	// destroy frees what is left
+	for (int i = 0; i < 10; i++)
+		llist_push(maxq, malloc(16));
+	llist_destroy(maxq, true, NULL);
+	llist_destroy(minq, false, NULL);
+}
+END_TEST
+
+unsigned long trivial_hash(llist_node node)
+{
+	return (unsigned long) node % 7;    // plenty of collisions
+}
+
+START_TEST(llist_41_unique)
+{
+	int flags = test_mt ? FLAG_MT_SUPPORT : 0;
+	llist list = llist_create(trivial_comperator, trivial_equal, flags);
+	llist noeq = llist_create(trivial_comperator, NULL, flags);
+	const unsigned long values[] = { 5, 3, 5, 9, 3, 3, 12, 9, 5, 2 };
+	llist_node found;
+
+	ck_assert_int_eq(llist_unique(NULL, trivial_hash, false, NULL),
+			 LLIST_NULL_ARGUMENT);
+	ck_assert_int_eq(llist_unique(list, NULL, false, NULL),
+			 LLIST_NULL_ARGUMENT);
+	ck_assert_int_eq(llist_unique(noeq, trivial_hash, false, NULL),
+			 LLIST_EQUAL_MISSING);
+	ck_assert_int_eq(llist_unique_sorted(noeq, false, NULL),
+			 LLIST_EQUAL_MISSING);
+	ck_assert_int_eq(llist_unique(list, trivial_hash, false, NULL),
+			 LLIST_SUCCESS);
+
+	for (int i = 0; i < 10; i++)
+		llist_add_node(list, (llist_node) values[i], ADD_NODE_REAR);
+
+	// adjacent runs only
+	ck_assert_int_eq(llist_unique_sorted(list, false, NULL), LLIST_SUCCESS);
+	check_values(list, (unsigned long []) { 5, 3, 5, 9, 3, 12, 9, 5, 2 },
+		     9);
+
+	// first occurrences, in order
+	ck_assert_int_eq(llist_unique(list, trivial_hash, false, NULL),
+			 LLIST_SUCCESS);
+	check_values(list, (unsigned long []) { 5, 3, 9, 12, 2 }, 5);
+
+	// a sorted list stays sorted
+	for (int i = 0; i < 1000; i++)
+		llist_add_node(list, (llist_node) (unsigned long) (i % 100),
+			       ADD_NODE_REAR);
+	ck_assert_int_eq(llist_sort(list, SORT_LIST_ASCENDING), LLIST_SUCCESS);
+	ck_assert_int_eq(llist_unique_sorted(list, false, NULL), LLIST_SUCCESS);
+	ck_assert_int_eq(llist_size(list), 100);
+	ck_assert_int_eq(llist_find_sorted(list, (void *) 42, &found),
+			 LLIST_SUCCESS);
+	ck_assert_int_eq((unsigned long) found, 42);
+	ck_assert_int_eq((unsigned long) llist_get_tail(list), 99);
+
+	ck_assert_int_eq(llist_unique(list, trivial_hash, false, NULL),
+			 LLIST_SUCCESS);
+	ck_assert_int_eq(llist_size(list), 100);
+
+	// the duplicates are destroyed
+	llist_destroy(list, false, NULL);
+	list = llist_create(NULL, trivial_equal, flags);
+	reclaimed_sum = 0;
+	for (int i = 0; i < 10; i++)
+		llist_add_node(list, (llist_node) values[i], ADD_NODE_REAR);
+	ck_assert_int_eq(llist_unique(list, trivial_hash, true,
+				      reclaim_destructor), LLIST_SUCCESS);
+	ck_assert_int_eq(reclaimed_sum, 5 + 5 + 3 + 3 + 9);
+	ck_assert_int_eq(llist_size(list), 5);
+
+	llist_destroy(noeq, false, NULL);
+	llist_destroy(list, false, NULL);
+}
+END_TEST
+
+void fill_values(llist list, const unsigned long *values, int count)
+{
+	for (int i = 0; i < count; i++)
+		llist_add_node(list, (llist_node) values[i], ADD_NODE_REAR);
+}
+
+START_TEST(llist_42_set_operations)
+{
+	int flags = test_mt ? FLAG_MT_SUPPORT : 0;
+	llist first = llist_create(trivial_comperator, trivial_equal, flags);
+	llist second = llist_create(trivial_comperator, trivial_equal, flags);
+	llist out = llist_create(trivial_comperator, trivial_equal, flags);
+	llist noeq = llist_create(trivial_comperator, NULL, flags);
+	llist_node found;
+
+	ck_assert_int_eq(llist_intersect(NULL, second, trivial_hash, out),
+			 LLIST_NULL_ARGUMENT);
+	ck_assert_int_eq(llist_union(first, first, trivial_hash, out),
+			 LLIST_ERROR);
+	ck_assert_int_eq(llist_difference(noeq, second, trivial_hash, out),
+			 LLIST_EQUAL_MISSING);
+
+	// hashed
+	fill_values(first, (unsigned long []) { 1, 2, 3, 4, 5, 3 }, 6);
+	fill_values(second, (unsigned long []) { 4, 5, 6, 7, 5 }, 5);
+	ck_assert_int_eq(llist_intersect(first, second, trivial_hash, out),
+			 LLIST_SUCCESS);
+	check_values(out, (unsigned long []) { 4, 5 }, 2);
+	check_values(first, (unsigned long []) { 1, 2, 3, 3 }, 4);
+	ck_assert_int_eq(llist_size(second), 5);
+
+	// not sorted, so it needs a hash function
+	ck_assert_int_eq(llist_difference(first, second, NULL, out),
+			 LLIST_ERROR);
+
+	llist_clear(out, false, NULL);
+	ck_assert_int_eq(llist_difference(first, second, trivial_hash, out),
+			 LLIST_SUCCESS);
+	check_values(out, (unsigned long []) { 1, 2, 3, 3 }, 4);
+	ck_assert(llist_is_empty(first));
+
+	llist_clear(out, false, NULL);
+	fill_values(first, (unsigned long []) { 1, 2, 3, 3 }, 4);
+	llist_add_node(second, (llist_node) 3, ADD_NODE_REAR);
+	ck_assert_int_eq(llist_union(first, second, trivial_hash, out),
+			 LLIST_SUCCESS);
+	check_values(out, (unsigned long []) { 1, 2, 3, 3, 4, 5, 6, 7 }, 8);
+	check_values(second, (unsigned long []) { 5, 3 }, 2);
+	ck_assert(llist_is_empty(first));
+
+	// merged
+	llist_clear(out, false, NULL);
+	llist_clear(second, false, NULL);
+	fill_values(first, (unsigned long []) { 9, 1, 7, 3, 5 }, 5);
+	fill_values(second, (unsigned long []) { 9, 3, 4, 9, 5, 6 }, 6);
+	llist_sort(first, SORT_LIST_ASCENDING);
+	llist_sort(second, SORT_LIST_ASCENDING);
+	llist_sort(out, SORT_LIST_ASCENDING);
+	ck_assert_int_eq(llist_intersect(first, second, NULL, out),
+			 LLIST_SUCCESS);
+	ck_assert_int_eq(llist_find_sorted(out, (void *) 5, &found),
+			 LLIST_SUCCESS);
+	ck_assert_int_eq(llist_find_sorted(first, (void *) 7, &found),
+			 LLIST_SUCCESS);
+	check_values(out, (unsigned long []) { 3, 5, 9 }, 3);
+	check_values(first, (unsigned long []) { 1, 7 }, 2);
+
+	llist_clear(out, false, NULL);
+	llist_clear(first, false, NULL);
+	fill_values(first, (unsigned long []) { 9, 1, 7, 3, 5 }, 5);
+	llist_sort(first, SORT_LIST_ASCENDING);
+	llist_sort(out, SORT_LIST_ASCENDING);
+	ck_assert_int_eq(llist_difference(first, second, NULL, out),
+			 LLIST_SUCCESS);
+	check_values(out, (unsigned long []) { 1, 7 }, 2);
+	check_values(first, (unsigned long []) { 3, 5, 9 }, 3);
+
+	llist_clear(out, false, NULL);
+	fill_values(first, (unsigned long []) { 1, 7 }, 2);
+	llist_sort(first, SORT_LIST_ASCENDING);
+	llist_sort(out, SORT_LIST_ASCENDING);
+	ck_assert_int_eq(llist_union(first, second, NULL, out), LLIST_SUCCESS);
+	ck_assert_int_eq(llist_find_sorted(out, (void *) 6, &found),
+			 LLIST_SUCCESS);
+	check_values(out, (unsigned long []) { 1, 3, 4, 5, 6, 7, 9 }, 7);
+	check_values(second, (unsigned long []) { 3, 5, 9, 9 }, 4);
+	ck_assert(llist_is_empty(first));
+
+	llist_destroy(noeq, false, NULL);
+	llist_destroy(out, false, NULL);
+	llist_destroy(second, false, NULL);
+	llist_destroy(first, false, NULL);
+}
+END_TEST
+
 Suite *liblist_suite(void)
 {
 	Suite *s = suite_create("Lib linked list tester");
@@ -711,6 +2741,30 @@ Suite *liblist_suite(void)
 	tcase_add_test(tc_core, llist_16_merge);
 	tcase_add_test(tc_core, llist_17_empty_list_ops);
 	tcase_add_test(tc_core, llist_18_null_arguments);
+	tcase_add_test(tc_core, llist_19_top_k_partial_sort);
+	tcase_add_test(tc_core, llist_20_min_max_aggregate);
+	tcase_add_test(tc_core, llist_21_external_sort);
+	tcase_add_test(tc_core, llist_22_keyed_lists);
+	tcase_add_test(tc_core, llist_23_find_sorted);
+	tcase_add_test(tc_core, llist_24_iterator);
+	tcase_add_test(tc_core, llist_25_for_each_until_remove_if);
+	tcase_add_test(tc_core, llist_26_parallel_for_each);
+	tcase_add_test(tc_core, llist_27_compact);
+	tcase_add_test(tc_core, llist_28_stats);
+	tcase_add_test(tc_core, llist_29_trace_hooks);
+	tcase_add_test(tc_core, llist_30_serialize);
+	tcase_add_test(tc_core, llist_31_persistent_list);
+	tcase_add_test(tc_core, llist_32_shared_memory_list);
+	tcase_add_test(tc_core, llist_33_split_splice_partition);
+	tcase_add_test(tc_core, llist_34_positional_access);
+	tcase_add_test(tc_core, llist_35_deferred_reclaim);
+	tcase_add_test(tc_core, llist_36_clear);
+	tcase_add_test(tc_core, llist_37_ring);
+	tcase_add_test(tc_core, llist_38_spsc_queue);
+	tcase_add_test(tc_core, llist_39_work_stealing);
+	tcase_add_test(tc_core, llist_40_priority_queue);
+	tcase_add_test(tc_core, llist_41_unique);
+	tcase_add_test(tc_core, llist_42_set_operations);
 
 	//really multithreaded test case
 	tcase_add_test(tc_mt, llist_01_create_delete_lists);
@@ -731,6 +2785,30 @@ Suite *liblist_suite(void)
 	tcase_add_test(tc_mt, llist_16_merge);
 	tcase_add_test(tc_mt, llist_17_empty_list_ops);
 	tcase_add_test(tc_mt, llist_18_null_arguments);
+	tcase_add_test(tc_mt, llist_19_top_k_partial_sort);
+	tcase_add_test(tc_mt, llist_20_min_max_aggregate);
+	tcase_add_test(tc_mt, llist_21_external_sort);
+	tcase_add_test(tc_mt, llist_22_keyed_lists);
+	tcase_add_test(tc_mt, llist_23_find_sorted);
+	tcase_add_test(tc_mt, llist_24_iterator);
+	tcase_add_test(tc_mt, llist_25_for_each_until_remove_if);
+	tcase_add_test(tc_mt, llist_26_parallel_for_each);
+	tcase_add_test(tc_mt, llist_27_compact);
+	tcase_add_test(tc_mt, llist_28_stats);
+	tcase_add_test(tc_mt, llist_29_trace_hooks);
+	tcase_add_test(tc_mt, llist_30_serialize);
+	tcase_add_test(tc_mt, llist_31_persistent_list);
+	tcase_add_test(tc_mt, llist_32_shared_memory_list);
+	tcase_add_test(tc_mt, llist_33_split_splice_partition);
+	tcase_add_test(tc_mt, llist_34_positional_access);
+	tcase_add_test(tc_mt, llist_35_deferred_reclaim);
+	tcase_add_test(tc_mt, llist_36_clear);
+	tcase_add_test(tc_mt, llist_37_ring);
+	tcase_add_test(tc_mt, llist_38_spsc_queue);
+	tcase_add_test(tc_mt, llist_39_work_stealing);
+	tcase_add_test(tc_mt, llist_40_priority_queue);
+	tcase_add_test(tc_mt, llist_41_unique);
+	tcase_add_test(tc_mt, llist_42_set_operations);
 
 	suite_add_tcase(s, tc_core);
 	suite_add_tcase(s, tc_mt);